@@ -252,3 +252,67 @@ TEST_CASE("madronalib/core/dspbuffer/vector", "[dspbuffer][peek]")
 }
 
 }  // namespace dspBufferTest
+
+TEST_CASE("madronalib/core/dspbuffer/process", "[dspbuffer][process]")
+{
+  // a process that adds the two inputs and counts the vectors it makes.
+  float vectorCount{0};
+  ProcessVectorFn fn = [&](MainInputs ins, MainOutputs outs, void*) {
+    outs[0] = ins[0] + ins[1];
+    outs[1] = DSPVector(++vectorCount);
+  };
+
+  constexpr int kMaxFrames{512};
+  std::vector<float> in0(kMaxFrames + 1), in1(kMaxFrames + 1), out0(kMaxFrames + 1),
+      out1(kMaxFrames + 1);
+  for (int i = 0; i < kMaxFrames + 1; ++i)
+  {
+    in0[i] = i + 1.f;
+    in1[i] = 1000.f;
+  }
+
+  // whole vectors are processed in place with no latency, from aligned or
+  // unaligned host buffers.
+  VectorProcessBuffer vpb(2, 2, kMaxFrames);
+  for (int offset : {0, 1})
+  {
+    const float* ins[2]{in0.data() + offset, in1.data() + offset};
+    float* outs[2]{out0.data() + offset, out1.data() + offset};
+    vpb.process(ins, outs, 128, fn);
+    bool same{true};
+    for (int i = 0; i < 128; ++i)
+    {
+      same &= (out0[i + offset] == in0[i + offset] + 1000.f);
+    }
+    REQUIRE(same);
+    REQUIRE(out1[offset + 127] == vectorCount);
+  }
+  REQUIRE(vectorCount == 4);
+
+  // a missing input is read as zeros.
+  const float* ins[2]{in0.data(), nullptr};
+  float* outs[2]{out0.data(), out1.data()};
+  vpb.process(ins, outs, 64, fn);
+  REQUIRE(out0[63] == 64.f);
+
+  // after a ragged block, blocks go through the buffers and stay in order. The
+  // buffers output zeros when they underflow, so only the signal is compared.
+  ins[1] = in1.data();
+  std::vector<float> stream;
+  int start{0};
+  for (int frames : {100, 128, 28, 256})
+  {
+    const float* ins2[2]{in0.data() + start, in1.data() + start};
+    vpb.process(ins2, outs, frames, fn);
+    stream.insert(stream.end(), out0.begin(), out0.begin() + frames);
+    start += frames;
+  }
+  float expected{1001.f};
+  for (float x : stream)
+  {
+    if (x == 0.f) continue;
+    if (x != expected) break;
+    expected += 1.f;
+  }
+  REQUIRE(expected > 1001.f + 256.f);
+}
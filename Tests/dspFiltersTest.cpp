@@ -68,3 +68,127 @@ TEST_CASE("madronalib/core/dsp_filters", "[dsp_filters]")
     DSPVector sineOut = downer.read();
   }
 }
+
+TEST_CASE("madronalib/core/dsp_filters/silence", "[dsp_filters]")
+{
+  Lopass lp;
+  lp._coeffs = Lopass::makeCoeffs(0.1f, 0.5f);
+  OnePole op;
+  op.mCoeffs = OnePole::coeffs(0.01f);
+
+  // excite the filters, then send silence until they settle.
+  DSPVector impulse;
+  impulse[0] = 1.f;
+  lp(impulse);
+  op(impulse);
+  REQUIRE(!lp.isSilent());
+  REQUIRE(!op.isSilent());
+
+  int vectors{0};
+  DSPVector lpOut, opOut;
+  while(!(lp.isSilent() && op.isSilent()) && (vectors++ < 10000))
+  {
+    lpOut = lp(DSPVector());
+    opOut = op(DSPVector());
+  }
+  REQUIRE(vectors < 10000);
+
+  // once settled, silent input produces exactly zero output.
+  REQUIRE(isZero(lp(DSPVector())));
+  REQUIRE(isZero(op(DSPVector())));
+
+  // glides report constant output when done.
+  LinearGlide g;
+  g.setGlideTimeInSamples(kFloatsPerDSPVector*4);
+  g.setValue(1.f);
+  g(1.f);
+  REQUIRE(g.getFlags() == kDSPVectorConstant);
+  g(2.f);
+  REQUIRE(g.getFlags() == kDSPVectorNoFlags);
+  DSPVector gOut;
+  for(int i=0; i<8; ++i) gOut = g(2.f);
+  REQUIRE(g.getFlags() == kDSPVectorConstant);
+  REQUIRE(getFlags(gOut) == kDSPVectorConstant);
+  REQUIRE(gOut[0] == 2.f);
+}
+
+TEST_CASE("madronalib/core/dsp_filters/sliding", "[dsp_filters]")
+{
+  // compare sliding window filters to brute force over a few window sizes.
+  RandomScalarSource rand;
+  constexpr int kVectors = 20;
+  std::vector<float> input(kVectors*kFloatsPerDSPVector);
+  for(auto& x : input) x = rand.getFloat();
+
+  for(size_t w : {1, 3, 64, 100, 257})
+  {
+    SlidingMax smax(w);
+    SlidingMin smin(w);
+    SlidingSum ssum(w);
+    bool maxOK{true}, minOK{true}, sumOK{true};
+    for(int v = 0; v < kVectors; ++v)
+    {
+      DSPVector x(input.data() + v*kFloatsPerDSPVector);
+      DSPVector yMax = smax(x);
+      DSPVector yMin = smin(x);
+      DSPVector ySum = ssum(x);
+      for(int i = 0; i < kFloatsPerDSPVector; ++i)
+      {
+        int t = v*kFloatsPerDSPVector + i;
+        float bMax{std::numeric_limits<float>::lowest()};
+        float bMin{std::numeric_limits<float>::max()};
+        float bSum{0.f};
+        for(int j = t - int(w) + 1; j <= t; ++j)
+        {
+          // history before the start is zero
+          float xj = (j >= 0) ? input[j] : 0.f;
+          bMax = std::max(bMax, xj);
+          bMin = std::min(bMin, xj);
+          bSum += xj;
+        }
+        maxOK &= (yMax[i] == bMax);
+        minOK &= (yMin[i] == bMin);
+        sumOK &= (fabs(ySum[i] - bSum) < 1e-4f);
+      }
+    }
+    REQUIRE(maxOK);
+    REQUIRE(minOK);
+    REQUIRE(sumOK);
+  }
+
+  // RMS of a constant is the constant, once the window is full.
+  SlidingRMS rms;
+  rms.setWindowInSamples(100);
+  DSPVector y;
+  for(int v = 0; v < 4; ++v) y = rms(DSPVector(-0.5f));
+  REQUIRE(fabs(y[kFloatsPerDSPVector - 1] - 0.5f) < 1e-6f);
+}
+
+TEST_CASE("madronalib/core/dsp_filters/adsr", "[dsp_filters]")
+{
+  // the vector ADSR should match the per-sample version.
+  ADSR a, b;
+  a.coeffs = b.coeffs = ADSR::calcCoeffs(0.005f, 0.02f, 0.5f, 0.03f, 48000.f);
+
+  // gate on in the middle of a vector, off later, then on again with a new amp.
+  auto gate = [](int t) {
+    if(t < 37) return 0.f;
+    if(t < 3000) return 0.8f;
+    if(t < 6000) return 0.f;
+    return 0.5f;
+  };
+
+  float maxDiff{0.f};
+  for(int v = 0; v < 8000/kFloatsPerDSPVector; ++v)
+  {
+    DSPVector x;
+    for(int i = 0; i < kFloatsPerDSPVector; ++i) x[i] = gate(v*kFloatsPerDSPVector + i);
+    DSPVector ya = a(x);
+    for(int i = 0; i < kFloatsPerDSPVector; ++i)
+    {
+      maxDiff = std::max(maxDiff, fabsf(ya[i] - b.processSample(x[i])));
+    }
+  }
+  REQUIRE(maxDiff < 1e-4f);
+  REQUIRE(a.segment == b.segment);
+}
@@ -55,3 +55,54 @@ TEST_CASE("madronalib/core/dsp_gens", "[dsp_gens]")
 
   
 }
+
+TEST_CASE("madronalib/core/dsp_gens/automation", "[dsp_gens]")
+{
+  AutomationRamps ramps(3);
+  auto near = [](float a, float b) { return fabsf(a - b) < 1e-5f; };
+
+  // two points inside the first vector and the next.
+  ramps.setValue(0, 0.f);
+  ramps.addPoint(0, 10, 1.f);
+  ramps.addPoint(0, 100, 0.f);
+
+  // one point a few vectors away.
+  ramps.setValue(1, 0.f);
+  ramps.addPoint(1, 200, 2.f);
+
+  REQUIRE(ramps.getNumActive() == 2);
+  ramps.process();
+  const DSPVector& r0 = ramps.getRamp(0);
+  const DSPVector& r1 = ramps.getRamp(1);
+  REQUIRE(near(r0[4], 5.f / 11.f));
+  REQUIRE(r0[10] == 1.f);
+  REQUIRE(near(r0[63], 1.f - 53.f / 90.f));
+  REQUIRE(near(r1[63], 2.f * 64.f / 201.f));
+
+  ramps.process();
+  REQUIRE(ramps.getRamp(0)[36] == 0.f);
+  REQUIRE(ramps.getRamp(0)[63] == 0.f);
+
+  ramps.process();
+  REQUIRE(!ramps.isActive(0));
+  ramps.process();
+  REQUIRE(ramps.getRamp(1)[8] == 2.f);
+  REQUIRE(ramps.getRamp(1)[63] == 2.f);
+  ramps.process();
+  REQUIRE(ramps.getNumActive() == 0);
+  REQUIRE(getFlags(ramps.getRamp(1)) == kDSPVectorConstant);
+
+  // parameters with no points cost nothing and output a constant.
+  REQUIRE(!ramps.isActive(2));
+  REQUIRE(isZero(ramps.getRamp(2)));
+
+  // after a long idle time, a new point should ramp from the end of the last
+  // vector, not from the time of the last point.
+  ramps.setValue(0, 0.f);
+  ramps.addPoint(0, 10, 1.f);
+  for (int i = 0; i < 1000; ++i) ramps.process();
+  ramps.addPoint(0, 6400, 2.f);
+  ramps.process();
+  REQUIRE(near(ramps.getRamp(0)[0], 1.f + 1.f / 6401.f));
+  REQUIRE(near(ramps.getRamp(0)[63], 1.f + 64.f / 6401.f));
+}
@@ -167,6 +167,26 @@ TEST_CASE("madronalib/core/dsp_ops", "[dsp_ops]")
     REQUIRE(fa[kFloatsPerDSPVector - 1] == -fb[kFloatsPerDSPVector - 1]);
   }
     
+  SECTION("flags")
+  {
+    DSPVector z{0.f};
+    DSPVector k{3.f};
+    DSPVector r{columnIndex()};
+    REQUIRE(getFlags(z) == kDSPVectorZero);
+    REQUIRE(getFlags(k) == kDSPVectorConstant);
+    REQUIRE(getFlags(r) == kDSPVectorNoFlags);
+    REQUIRE(isZero(DSPVector{-0.f}));
+    REQUIRE(isConstant(repeatRows<2>(k) + rowIndex<2>()));
+    REQUIRE(!isConstant(repeatRows<2>(r)));
+
+    // propagated flags must agree with the flags of the computed results
+    REQUIRE(multiplyFlags(getFlags(z), getFlags(r)) == getFlags(z * r));
+    REQUIRE(multiplyFlags(getFlags(k), getFlags(k)) == getFlags(k * k));
+    REQUIRE(combineFlags(getFlags(z), getFlags(k)) == getFlags(z + k));
+    REQUIRE(combineFlags(getFlags(k), getFlags(r)) == getFlags(k + r));
+    REQUIRE(divideFlags(getFlags(z), getFlags(r + 1.f)) == getFlags(z / (r + 1.f)));
+  }
+
   SECTION("map")
   {
     constexpr int rows = 2;
@@ -273,6 +293,39 @@ TEST_CASE("madronalib/core/dsp_ops", "[dsp_ops]")
     REQUIRE(demuxInput3 == demuxThenMux);
   }
   
+  SECTION("process fader")
+  {
+    int aCalls{0}, bCalls{0};
+    auto branchA = [&]() { aCalls++; return DSPVector(1.f); };
+    auto branchB = [&]() { bCalls++; return DSPVector(3.f); };
+
+    ProcessFader<1> fader;
+    fader.setWarmupTimeInSamples(kFloatsPerDSPVector);
+    fader.setFadeTimeInSamples(kFloatsPerDSPVector * 2);
+
+    // steady state: only the selected branch runs
+    auto y = fader(0, branchA, branchB);
+    REQUIRE(y == DSPVector(1.f));
+    REQUIRE(aCalls == 1);
+    REQUIRE(bCalls == 0);
+
+    // switch: one vector of warmup with output discarded, then two of crossfade
+    y = fader(1, branchA, branchB);
+    REQUIRE(y == DSPVector(1.f));
+    y = fader(1, branchA, branchB);
+    REQUIRE(y[kFloatsPerDSPVector - 1] == 2.f);
+    y = fader(1, branchA, branchB);
+    REQUIRE(y[kFloatsPerDSPVector - 1] == 3.f);
+    REQUIRE(!fader.isSwitching());
+    REQUIRE(aCalls == 4);
+    REQUIRE(bCalls == 3);
+
+    // steady state again
+    y = fader(1, branchA, branchB);
+    REQUIRE(y == DSPVector(3.f));
+    REQUIRE(aCalls == 4);
+  }
+
   SECTION("bank")
   {
     constexpr size_t n = 5;
@@ -336,6 +389,33 @@ TEST_CASE("madronalib/core/projections", "[projections]")
     }
   }
 
+  {
+    // tabulated projections should match the originals within their reported error,
+    // both scalar and vectorized.
+    Interval domain{20.f, 20000.f};
+    auto p = compose(projections::log({20.f, 20000.f}), projections::linear(domain, {0.f, 1.f}));
+    TabulatedProjection lin(p, domain, 256, TabulatedProjection::kLinear);
+    TabulatedProjection cub(p, domain, 256, TabulatedProjection::kCubic);
+    REQUIRE(lin.getMaxError() < 1e-3f);
+    REQUIRE(cub.getMaxError() < lin.getMaxError());
+
+    DSPVector x{columnIndex()*(19980.f/63.f) + DSPVector(20.f)};
+    DSPVector yLin = lin(x);
+    DSPVector yCub = cub(x);
+    float maxErr{0.f};
+    for(int i=0; i<kFloatsPerDSPVector; ++i)
+    {
+      maxErr = std::max(maxErr, fabsf(yLin[i] - lin(x[i])));
+      maxErr = std::max(maxErr, fabsf(yCub[i] - cub(x[i])));
+      maxErr = std::max(maxErr, fabsf(yCub[i] - p(x[i])) - cub.getMaxError());
+    }
+    REQUIRE(maxErr < 1e-6f);
+
+    // input is clamped to the domain
+    REQUIRE(lin(0.f) == lin(20.f));
+    REQUIRE(lin(1e6f) == lin(20000.f));
+  }
+
   // print interval
   Interval v1{0.123, 5.567};
 
@@ -348,4 +428,41 @@ TEST_CASE("madronalib/core/sse-ops", "[sse-ops]") {
 
   auto v3 = (f1 * f2);
   std::cout << v3 << std::endl;
-}
\ No newline at end of file
+}
+TEST_CASE("madronalib/core/scale", "[scale]")
+{
+  // a just scale, with one key unmapped so that some notes have no pitch.
+  const char* justScale = "! just\nJust\n 7\n9/8\n5/4\n4/3\n3/2\n5/3\n15/8\n2/1\n";
+  const char* justMap = "! map\n8\n0\n127\n60\n69\n440.0\n7\n0\n1\n2\nx\n4\n5\n6\n";
+  Scale et, just;
+  just.loadScaleFromString(justScale, justMap);
+
+  // notes and pitches over the whole table, out of range and NaN.
+  DSPVectorArray<4> notes, pitches;
+  for (int i = 0; i < kFloatsPerDSPVector * 4; ++i)
+  {
+    notes.getBuffer()[i] = i * (kMLNumNotes + 20.f) / (kFloatsPerDSPVector * 4) - 10.f;
+    pitches.getBuffer()[i] = i * 24.f / (kFloatsPerDSPVector * 4) - 12.f;
+  }
+  notes.row(0)[1] = pitches.row(0)[1] = std::numeric_limits<float>::quiet_NaN();
+
+  for (auto* pScale : {&et, &just})
+  {
+    float maxErr{0.f};
+    bool quantizeSame{true};
+    for (int j = 0; j < 4; ++j)
+    {
+      DSPVector vp = pScale->noteToLogPitch(notes.row(j));
+      DSPVector vq = pScale->quantizePitch(pitches.row(j));
+      DSPVector vn = pScale->quantizePitchNearest(pitches.row(j));
+      for (int i = 0; i < kFloatsPerDSPVector; ++i)
+      {
+        maxErr = std::max(maxErr, fabsf(vp[i] - pScale->noteToLogPitch(notes.row(j)[i])));
+        quantizeSame &= (vq[i] == pScale->quantizePitch(pitches.row(j)[i]));
+        quantizeSame &= (vn[i] == pScale->quantizePitchNearest(pitches.row(j)[i]));
+      }
+    }
+    REQUIRE(maxErr < 1e-5f);
+    REQUIRE(quantizeSame);
+  }
+}
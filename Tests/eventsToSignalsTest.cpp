@@ -0,0 +1,100 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020-2022 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "MLEventsToSignals.h"
+
+using namespace ml;
+
+TEST_CASE("madronalib/core/events_to_signals/voices", "[events_to_signals]")
+{
+  constexpr int kSr{48000};
+  constexpr int kVoices{128};
+  EventsToSignals e2s(kSr);
+  REQUIRE(e2s.setPolyphony(kVoices) == kVoices);
+
+  auto noteOn = [&](int note, int time) {
+    e2s.addEvent({kNoteOn, 1, note, time, (float)(note % 128), 0.5f, 0, 0});
+  };
+  auto noteOff = [&](int note, int time) {
+    e2s.addEvent({kNoteOff, 1, note, time, (float)(note % 128), 0, 0, 0});
+  };
+
+  // fill all the voices over two vectors.
+  for (int i = 0; i < kVoices; ++i)
+  {
+    noteOn(i, i % kFloatsPerDSPVector);
+    if (i == kVoices / 2 - 1) e2s.process();
+  }
+  e2s.process();
+
+  int voicesOn{0};
+  for (int v = 0; v < kVoices; ++v)
+  {
+    voicesOn += (e2s.voices[v].outputs.row(kGate)[kFloatsPerDSPVector - 1] == 0.5f);
+  }
+  REQUIRE(voicesOn == kVoices);
+
+  // gate and age are written from the note start.
+  auto& v0 = e2s.voices[0].outputs;
+  REQUIRE(v0.row(kGate)[0] == 0.5f);
+  REQUIRE(fabsf(v0.row(kElapsedTime)[kFloatsPerDSPVector - 1] - 128.f / kSr) < 1e-6f);
+  auto& v1 = e2s.voices[kVoices / 2 + 1].outputs;
+  REQUIRE(v1.row(kGate)[0] == 0.f);
+  REQUIRE(v1.row(kGate)[1] == 0.5f);
+
+  // voices released first are reused first.
+  noteOff(10, 0);
+  noteOff(3, 0);
+  e2s.process();
+  noteOn(200, 0);
+  e2s.process();
+  REQUIRE(e2s.getNewestVoice() == 10);
+  noteOn(201, 0);
+  e2s.process();
+  REQUIRE(e2s.getNewestVoice() == 3);
+
+  // with no free voices, one is stolen.
+  noteOn(202, 0);
+  e2s.process();
+  REQUIRE(e2s.getNewestVoice() >= 0);
+  REQUIRE(e2s.getNewestVoice() < kVoices);
+}
+
+TEST_CASE("madronalib/core/events_to_signals/events", "[events_to_signals]")
+{
+  constexpr int kSr{48000};
+  EventsToSignals e2s(kSr);
+  e2s.setPolyphony(4);
+
+  // events added out of order are processed in time order.
+  std::vector<EventsToSignals::Event> events{
+      {kNoteOff, 1, 60, 50, 60, 0, 0, 0},
+      {kNoteOn, 1, 60, 10, 60, 0.5f, 0, 0}};
+  REQUIRE(e2s.addEvents(events.data(), events.size()) == 2);
+  e2s.process();
+  int v = e2s.getNewestVoice();
+  REQUIRE(v >= 0);
+  auto& gate = e2s.voices[v].outputs.row(kGate);
+  REQUIRE(gate[9] == 0.f);
+  REQUIRE(gate[10] == 0.5f);
+  REQUIRE(gate[49] == 0.5f);
+  REQUIRE(gate[50] == 0.f);
+
+  // a dense stream of controller updates fits, and the last value in time
+  // order wins. That's the last event at time 63, i = 575.
+  events.clear();
+  for (int i = 0; i < 600; ++i)
+  {
+    events.push_back({kNotePressure, 1, 0, static_cast<int>(i % kFloatsPerDSPVector),
+                      static_cast<float>(i) / 600.f, 0, 0, 0});
+  }
+  events.push_back({kNotePressure, 1, 0, 0, 0.25f, 0, 0, 0});
+  REQUIRE(e2s.addEvents(events.data(), events.size()) == events.size());
+  e2s.process();
+  REQUIRE(e2s.voices[0].currentZ == 575 / 600.f);
+}
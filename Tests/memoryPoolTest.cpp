@@ -0,0 +1,131 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020-2022 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "madronalib.h"
+
+using namespace ml;
+
+TEST_CASE("madronalib/core/memory_pool/basic", "[memory_pool]")
+{
+  MemoryPool pool(1 << 14);
+  auto stats = pool.getStats();
+  REQUIRE(stats.sizeClasses[0].blockSize == 32);
+  REQUIRE(stats.sizeClasses[0].capacity == 512);
+  REQUIRE(stats.sizeClasses[MemoryPool::kNumSizeClasses - 1].capacity == 2);
+
+  // fill the smallest size class, then one more falls back to malloc.
+  std::vector<void*> blocks;
+  for (int i = 0; i < 513; ++i)
+  {
+    blocks.push_back(pool.allocate(20));
+  }
+  stats = pool.getStats();
+  REQUIRE(stats.sizeClasses[0].inUse == 512);
+  REQUIRE(stats.fallbacks == 1);
+
+  // large requests fall back to malloc.
+  blocks.push_back(pool.allocate(MemoryPool::kMaxBlockSize + 1));
+  blocks.push_back(pool.allocate(MemoryPool::kMaxBlockSize));
+  blocks.push_back(pool.allocate(33));
+  stats = pool.getStats();
+  REQUIRE(stats.fallbacks == 2);
+  REQUIRE(stats.sizeClasses[1].inUse == 1);
+  REQUIRE(stats.sizeClasses[MemoryPool::kNumSizeClasses - 1].inUse == 1);
+
+  for (auto p : blocks)
+  {
+    pool.deallocate(p);
+  }
+  pool.deallocate(nullptr);
+  stats = pool.getStats();
+  REQUIRE(stats.sizeClasses[0].inUse == 0);
+  REQUIRE(stats.sizeClasses[0].highWater == 512);
+  REQUIRE(stats.sizeClasses[1].inUse == 0);
+}
+
+TEST_CASE("madronalib/core/memory_pool/threads", "[memory_pool]")
+{
+  // threads allocate and free blocks of many sizes. No block should ever be
+  // given to two threads at once.
+  MemoryPool pool(1 << 14);
+  constexpr int kThreads{4};
+  std::vector<std::thread> threads;
+  std::vector<int> errors(kThreads);
+  for (int t = 0; t < kThreads; ++t)
+  {
+    threads.emplace_back([&pool, &errors, t]() {
+      std::vector<std::pair<uint8_t*, size_t> > held;
+      uint32_t seed = t + 1;
+      for (int i = 0; i < 20000; ++i)
+      {
+        seed = seed * 1664525 + 1013904223;
+        if ((held.size() < 64) && (seed & 0x100))
+        {
+          size_t size = 1 + ((seed >> 16) & 0x3FF);
+          auto p = static_cast<uint8_t*>(pool.allocate(size));
+          memset(p, t, size);
+          held.emplace_back(p, size);
+        }
+        else if (!held.empty())
+        {
+          auto h = held.back();
+          held.pop_back();
+          for (size_t j = 0; j < h.second; ++j)
+          {
+            errors[t] += (h.first[j] != t);
+          }
+          pool.deallocate(h.first);
+        }
+      }
+      for (auto h : held)
+      {
+        pool.deallocate(h.first);
+      }
+    });
+  }
+  for (auto& th : threads)
+  {
+    th.join();
+  }
+
+  int totalErrors{0};
+  for (auto e : errors) totalErrors += e;
+  REQUIRE(totalErrors == 0);
+  size_t inUse{0};
+  for (auto& s : pool.getStats().sizeClasses)
+  {
+    inUse += s.inUse;
+  }
+  REQUIRE(inUse == 0);
+}
+
+TEST_CASE("madronalib/core/memory_pool/clients", "[memory_pool]")
+{
+  // long Text, Value and Matrix data comes from the pool.
+  auto inUse = []() {
+    size_t sum{0};
+    for (auto& s : theMemoryPool().getStats().sizeClasses) sum += s.inUse;
+    return sum;
+  };
+  size_t before = inUse();
+  size_t fallbacksBefore = theMemoryPool().getStats().fallbacks;
+  {
+    Text longText("a long piece of text that will not fit in a TextFragment's local storage, "
+                  "which is big enough for sixteen code points.");
+    std::vector<uint8_t> bytes(500);
+    Value blob(bytes.data(), bytes.size());
+    Value textValue(longText);
+    Value matrixValue(Matrix(256));
+    REQUIRE(inUse() == before + 5);
+  }
+  REQUIRE(inUse() == before);
+  REQUIRE(theMemoryPool().getStats().fallbacks == fallbacksBefore);
+}
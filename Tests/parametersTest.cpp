@@ -0,0 +1,180 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020-2022 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <atomic>
+#include <thread>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "MLSignalProcessor.h"
+
+using namespace ml;
+
+namespace parametersTest
+{
+inline void readTestParameterDescriptions(ParameterDescriptionList& params)
+{
+  params.push_back(std::make_unique<ParameterDescription>(WithValues{
+      {"name", "freq"}, {"range", {40, 4000}}, {"log", true}, {"units", "Hz"}}));
+  params.push_back(std::make_unique<ParameterDescription>(WithValues{
+      {"name", "osc/gain"}, {"range", {0, 2}}}));
+  params.push_back(std::make_unique<ParameterDescription>(WithValues{
+      {"name", "osc/shape"}, {"range", {-1, 1}}, {"bisquare", true}}));
+}
+
+// expose the protected param access of SignalProcessor.
+class TestProcessor : public SignalProcessor
+{
+ public:
+  TestProcessor() : SignalProcessor(0, 2) {}
+  float getReal(Path pname) { return getRealFloatParam(pname); }
+  float getNormalized(Path pname) { return getNormalizedFloatParam(pname); }
+  float getReal(ParamHandle h) { return getRealFloatParam(h); }
+  float getNormalized(ParamHandle h) { return getNormalizedFloatParam(h); }
+  const ParameterSnapshot::Values& getSnapshot() { return getParamSnapshot(); }
+};
+}  // namespace parametersTest
+
+using namespace parametersTest;
+
+TEST_CASE("madronalib/core/parameters/snapshot", "[parameters]")
+{
+  TestProcessor proc;
+  ParameterDescriptionList pdl;
+  readTestParameterDescriptions(pdl);
+  proc.buildParams(pdl);
+  proc.setDefaultParams();
+
+  REQUIRE(proc.getParamID("freq") == 0);
+  REQUIRE(proc.getParamID("osc/shape") == 2);
+  REQUIRE(proc.getParamID("osc") == SignalProcessor::kNoParamID);
+  REQUIRE(proc.getParamID("nothing") == SignalProcessor::kNoParamID);
+
+  REQUIRE(proc.getNormalized("osc/gain") == 0.5f);
+  REQUIRE(proc.getReal("osc/gain") == 1.f);
+  proc.setParamFromNormalizedValue("osc/gain", 0.25f);
+  REQUIRE(proc.getReal("osc/gain") == 0.5f);
+  REQUIRE(proc.getReal("nothing") == 0.f);
+
+  // while one thread writes, the reader should only see published pairs of
+  // values that belong together.
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    for (int i = 0; i <= 1000; ++i)
+    {
+      proc.setParamFromNormalizedValue("osc/gain", i / 1000.f);
+    }
+    done = true;
+  });
+
+  bool consistent{true};
+  while (!done)
+  {
+    auto& values = proc.getSnapshot();
+    float n = values.normalized[1];
+    float r = values.real[1];
+    consistent &= (r == n * 2.f);
+  }
+  writer.join();
+  REQUIRE(consistent);
+  REQUIRE(proc.getReal("osc/gain") == 2.f);
+}
+
+TEST_CASE("madronalib/core/parameters/handles", "[parameters]")
+{
+  TestProcessor proc;
+  ParameterDescriptionList pdl;
+  readTestParameterDescriptions(pdl);
+  proc.buildParams(pdl);
+  proc.setDefaultParams();
+
+  REQUIRE(proc.getNumParams() == 3);
+  auto hGain = proc.getParamHandle("osc/gain");
+  auto hShape = proc.getParamHandle("osc/shape");
+  auto hNone = proc.getParamHandle("osc/none");
+  REQUIRE(hGain);
+  REQUIRE(hShape != hGain);
+  REQUIRE(!hNone);
+  REQUIRE(proc.getParamName(hShape) == Path("osc/shape"));
+
+  // writes by handle or by name are seen by both kinds of reads.
+  proc.setParamFromNormalizedValue(hGain, 0.75f);
+  REQUIRE(proc.getReal(hGain) == 1.5f);
+  REQUIRE(proc.getReal("osc/gain") == 1.5f);
+  proc.setParamFromNormalizedValue("osc/shape", 1.f);
+  REQUIRE(proc.getReal(hShape) == 1.f);
+  REQUIRE(proc.getNormalized(hShape) == 1.f);
+
+  // bad handles are ignored.
+  proc.setParamFromNormalizedValue(hNone, 1.f);
+  REQUIRE(proc.getReal(hNone) == 0.f);
+
+  // with many params, every name should still find its own ID.
+  for (int i = 0; i < 100; ++i)
+  {
+    pdl.push_back(std::make_unique<ParameterDescription>(WithValues{
+        {"name", TextFragment("bank/", textUtils::naturalNumberToText(i))}}));
+  }
+  proc.buildParams(pdl);
+  bool idsOK{true};
+  for (size_t id = 0; id < proc.getNumParams(); ++id)
+  {
+    idsOK &= (proc.getParamID(proc.getParamName(ParamHandle{id})) == id);
+  }
+  REQUIRE(proc.getNumParams() == 103);
+  REQUIRE(idsOK);
+  REQUIRE(proc.getParamID("bank/100") == SignalProcessor::kNoParamID);
+}
+
+TEST_CASE("madronalib/core/parameters/conversions", "[parameters]")
+{
+  ParameterDescriptionList pdl;
+  readTestParameterDescriptions(pdl);
+  pdl.push_back(std::make_unique<ParameterDescription>(WithValues{
+      {"name", "voices"}, {"units", "list"}, {"listitems", "1/2/4/8"}, {"use_list_values_as_int", true}}));
+  pdl.push_back(std::make_unique<ParameterDescription>(WithValues{
+      {"name", "mode"}, {"units", "list"}, {"num_items", 3}}));
+  ParameterTree params;
+  buildParameterTree(pdl, params);
+
+  auto near = [](float a, float b) { return fabsf(a - b) <= 1e-5f * std::max(1.f, fabsf(b)); };
+
+  // log, linear and bisquare params
+  REQUIRE(near(params.convertNormalizedToRealFloatValue("freq", 0.f), 40.f));
+  REQUIRE(near(params.convertNormalizedToRealFloatValue("freq", 0.5f), 400.f));
+  REQUIRE(near(params.convertNormalizedToRealFloatValue("freq", 1.f), 4000.f));
+  REQUIRE(near(params.convertRealToNormalizedFloatValue("freq", 400.f), 0.5f));
+  REQUIRE(near(params.convertNormalizedToRealFloatValue("osc/gain", 0.25f), 0.5f));
+  REQUIRE(near(params.convertNormalizedToRealFloatValue("osc/shape", 0.25f), -0.25f));
+  REQUIRE(near(params.convertRealToNormalizedFloatValue("osc/shape", -0.25f), 0.25f));
+
+  // list params
+  REQUIRE(params.convertNormalizedToRealFloatValue("voices", 0.f) == 1.f);
+  REQUIRE(params.convertNormalizedToRealFloatValue("voices", 0.6f) == 4.f);
+  REQUIRE(params.convertNormalizedToRealFloatValue("voices", 1.f) == 8.f);
+  REQUIRE(near(params.convertRealToNormalizedFloatValue("voices", 4.f), 2.f / 3.f));
+  REQUIRE(params.convertRealToNormalizedFloatValue("voices", 3.f) == 0.f);
+  REQUIRE(params.convertNormalizedToRealFloatValue("mode", 0.5f) == 1.f);
+  REQUIRE(params.projections["voices"].normalizedToReal(1.f) == 3.f);
+
+  // missing params
+  REQUIRE(params.convertNormalizedToRealFloatValue("osc", 0.5f) == 0.f);
+
+  // batch conversion should match single conversions.
+  std::vector<float> norm(67), real(67);
+  for (int i = 0; i < norm.size(); ++i) norm[i] = i / 66.f;
+  bool batchOK{true};
+  for (auto pname : {"freq", "osc/gain", "osc/shape", "voices"})
+  {
+    auto& c = params.conversions[pname];
+    c.normalizedToReal(norm.data(), real.data(), norm.size());
+    for (int i = 0; i < norm.size(); ++i)
+    {
+      batchOK &= near(real[i], c.normalizedToReal(norm[i]));
+    }
+  }
+  REQUIRE(batchOK);
+}
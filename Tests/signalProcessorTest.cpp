@@ -0,0 +1,144 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020-2022 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <atomic>
+#include <thread>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "MLSignalProcessor.h"
+
+using namespace ml;
+
+namespace signalProcessorTest
+{
+constexpr size_t kTestVoices{24};
+
+// a processor with a bank of sine voices, rendered with renderVoices().
+class VoicesProcessor : public SignalProcessor
+{
+  std::array<SineGen, kTestVoices> _oscs;
+  std::array<DSPVector, kTestVoices> _voiceOutputs;
+
+ public:
+  VoicesProcessor() : SignalProcessor(0, 1) {}
+
+  DSPVector renderAll()
+  {
+    return renderVoices(kTestVoices, _voiceOutputs.data(), [&](size_t v) {
+      return _oscs[v](DSPVector((v + 1) * 0.001f));
+    });
+  }
+};
+}  // namespace signalProcessorTest
+
+using namespace signalProcessorTest;
+
+TEST_CASE("madronalib/core/signal_processor/workers", "[signal_processor]")
+{
+  // rendering with workers should give exactly the same result as serial.
+  VoicesProcessor serial, parallel;
+  parallel.setNumWorkerThreads(3);
+
+  bool same{true};
+  for (int i = 0; i < 200; ++i)
+  {
+    DSPVector a = serial.renderAll();
+    DSPVector b = parallel.renderAll();
+    same &= (a == b);
+  }
+  REQUIRE(same);
+
+  // every task runs exactly once, including when workers have gone to sleep.
+  SignalProcessor::WorkerPool pool;
+  pool.start(2);
+  for (int j = 0; j < 3; ++j)
+  {
+    std::array<std::atomic<int>, 100> counts{};
+    pool.parallelFor(counts.size(), [&](size_t i) { counts[i]++; });
+    bool once{true};
+    for (auto& c : counts) once &= (c == 1);
+    REQUIRE(once);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  pool.stop();
+  REQUIRE(pool.getNumThreads() == 0);
+}
+
+TEST_CASE("madronalib/core/signal_processor/time", "[signal_processor]")
+{
+  constexpr double kSr{48000};
+  constexpr double kQuartersPerSample{2. / kSr};  // 120 bpm
+  SignalProcessor::ProcessTime t;
+
+  // not playing
+  t.setTimeAndRate(0., 0., 120., false, kSr);
+  t.process();
+  REQUIRE(t._quarterNotesPhase[0] == -1.f);
+  REQUIRE(t.getPhasorAtRatio(0.25)[kFloatsPerDSPVector - 1] == -1.f);
+
+  // start, then lock to the host after one block of 512 samples.
+  double ppq0 = 4.5;
+  t.setTimeAndRate(1., ppq0, 120., true, kSr);
+  for (int i = 0; i < 8; ++i) t.process();
+  double ppq1 = ppq0 + 512 * kQuartersPerSample;
+  t.setTimeAndRate(1. + 512 / kSr, ppq1, 120., true, kSr);
+
+  // run long enough to wrap the phases a few times, and compare with the phases
+  // computed in double precision from the host position. Phases are compared
+  // around the circle, since they wrap into (0, 1] and not [0, 1).
+  auto wrap = [](double p) { return p - floor(p); };
+  auto phaseErr = [](float a, double b) {
+    float d = fabsf(a - (float)(b - floor(b)));
+    return std::min(d, 1.f - d);
+  };
+  auto inRange = [](const DSPVector& x) {
+    bool r{true};
+    for (int i = 0; i < kFloatsPerDSPVector; ++i) r &= (x[i] > 0.f) && (x[i] <= 1.f);
+    return r;
+  };
+  double omega = wrap(ppq1);
+  float maxErr{0.f};
+  bool phasesInRange{true};
+  for (int v = 0; v < 800; ++v)
+  {
+    t.process();
+    DSPVector bars = t.getPhasorAtRatio(0.25);
+    DSPVector triplets = t.getPhasorAtRatio(3.);
+    phasesInRange &= inRange(t._quarterNotesPhase) && inRange(t._secondsPhase);
+    phasesInRange &= inRange(bars) && inRange(triplets);
+    for (int i = 0; i < kFloatsPerDSPVector; ++i)
+    {
+      double q = 4. + omega + (v * kFloatsPerDSPVector + i) * kQuartersPerSample;
+      double s = 1. + (512 + v * kFloatsPerDSPVector + i) / kSr;
+      maxErr = std::max(maxErr, phaseErr(t._quarterNotesPhase[i], q));
+      maxErr = std::max(maxErr, phaseErr(bars[i], q * 0.25));
+      maxErr = std::max(maxErr, phaseErr(triplets[i], q * 3.));
+      maxErr = std::max(maxErr, phaseErr(t._secondsPhase[i], s));
+      maxErr = std::max(maxErr, fabsf(t._seconds[i] - (float)s));
+    }
+  }
+  REQUIRE(maxErr < 1e-5f);
+  REQUIRE(phasesInRange);
+
+  // with the host updating the time every 8 vectors, every sample of every
+  // phasor should stay in (0, 1].
+  double ppq = ppq1 + 800 * kFloatsPerDSPVector * kQuartersPerSample;
+  double secs = 1. + (512 + 800 * kFloatsPerDSPVector) / kSr;
+  for (int v = 0; v < 2400; ++v)
+  {
+    if (v % 8 == 0)
+    {
+      t.setTimeAndRate(secs, ppq, 120., true, kSr);
+    }
+    t.process();
+    phasesInRange &= inRange(t._quarterNotesPhase) && inRange(t._secondsPhase);
+    phasesInRange &= inRange(t.getPhasorAtRatio(0.25)) && inRange(t.getPhasorAtRatio(3.));
+    ppq += kFloatsPerDSPVector * kQuartersPerSample;
+    secs += kFloatsPerDSPVector / kSr;
+  }
+  REQUIRE(phasesInRange);
+}
@@ -4,6 +4,7 @@
 
 // a unit test made using the Catch framework in catch.hpp / tests.cpp.
 
+#include <atomic>
 #include <chrono>
 #include <cstring>
 #include <iostream>
@@ -80,6 +81,90 @@ TEST_CASE("madronalib/core/symbol/threads", "[symbol][threads]")
   REQUIRE(theSymbolTable().getSize() == kThreadTestSize + 1);
 }
 
+TEST_CASE("madronalib/core/symbol/concurrent", "[symbol][threads]")
+{
+  // readers look up existing symbols and their texts while writers add many
+  // new ones, which makes the table grow.
+  theSymbolTable().clear();
+  const int kExisting = 64;
+  std::vector<std::string> names;
+  std::vector<Symbol> syms;
+  for (int i = 0; i < kExisting; ++i)
+  {
+    names.push_back("existing_symbol_" + std::to_string(i));
+    syms.push_back(Symbol(names.back().c_str()));
+  }
+
+  std::atomic<bool> done{false};
+  std::atomic<bool> readsOK{true};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t)
+  {
+    readers.push_back(std::thread([&]() {
+      while (!done)
+      {
+        for (int i = 0; i < kExisting; ++i)
+        {
+          Symbol s(names[i].c_str());
+          if ((s != syms[i]) || (names[i] != s.getUTF8Ptr())) readsOK = false;
+        }
+      }
+    }));
+  }
+
+  const int kNewPerWriter = 5000;
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 4; ++t)
+  {
+    writers.push_back(std::thread([t, kNewPerWriter]() {
+      for (int i = 0; i < kNewPerWriter; ++i)
+      {
+        Symbol(("new_symbol_" + std::to_string(i * 4 + t)).c_str());
+      }
+    }));
+  }
+  for (auto& w : writers) w.join();
+  done = true;
+  for (auto& r : readers) r.join();
+
+  REQUIRE(readsOK);
+  REQUIRE(theSymbolTable().getSize() == kExisting + 4 * kNewPerWriter + 1);
+  REQUIRE(theSymbolTable().audit());
+}
+
+TEST_CASE("madronalib/core/symbol/literals", "[symbol]")
+{
+  // symbols from literals are the same as symbols from other text.
+  std::string setParam("set_param");
+  const char* pSetParam = setParam.c_str();
+  for (int i = 0; i < 3; ++i)
+  {
+    REQUIRE(Symbol("set_param") == Symbol(pSetParam));
+    REQUIRE(Symbol("set_param").getTextFragment() == TextFragment("set_param"));
+  }
+  REQUIRE(Symbol("").getID() == 0);
+
+  // constant arrays on the stack may reuse the address of an earlier one.
+  auto makeSym = [](int i) {
+    const char name[4] = {'x', char('a' + i), 0, 0};
+    return Symbol(name);
+  };
+  bool sameAsText{true};
+  for (int i = 0; i < 20; ++i)
+  {
+    std::string text{'x', char('a' + (i % 10))};
+    sameAsText &= (makeSym(i % 10) == Symbol(text.c_str()));
+  }
+  REQUIRE(sameAsText);
+
+  // non-constant arrays are looked up by their current text.
+  char buf[8] = "abc";
+  Symbol abc(buf);
+  buf[1] = 'x';
+  REQUIRE(Symbol(buf) == Symbol("axc"));
+  REQUIRE(abc == Symbol("abc"));
+}
+
 TEST_CASE("madronalib/core/collision", "[collision]")
 {
   // nothing is checked here - these are two pairs of colliding symbols for
@@ -94,9 +179,9 @@ TEST_CASE("madronalib/core/collision", "[collision]")
 }
 
 template <size_t N>
-constexpr int hashTest1(const char (&sym)[N])
+constexpr uint64_t hashTest1(const char (&sym)[N])
 {
-  return krHash1<N>(sym);
+  return hash(sym);
 }
 
 TEST_CASE("madronalib/core/hashes", "[hashes]")
@@ -105,18 +190,19 @@ TEST_CASE("madronalib/core/hashes", "[hashes]")
   const char* str1("hello");
   const char* str2(u8"محمد بن سعيد");
 
-  constexpr int a1 = hashTest1("hello");
-  constexpr int a2 = hashTest1(u8"محمد بن سعيد");
+  constexpr uint64_t a1 = hashTest1("hello");
+  constexpr uint64_t a2 = hashTest1(u8"محمد بن سعيد");
 
-  int b1 = krHash0(str1, strlen(str1));
-  int b2 = krHash0(str2, strlen(str2));
+  uint64_t b1 = fnv1aHash(str1, strlen(str1));
+  uint64_t b2 = fnv1aHash(str2, strlen(str2));
 
   REQUIRE(a1 == b1);
   REQUIRE(a2 == b2);
-  
-  
-  auto h = hash(Symbol());
-  //std::cout << "hash of null symbol: " << h << "\n";
+
+  // a symbol's stored hash is the hash of its text.
+  REQUIRE(hash(Symbol(str1)) == a1);
+  REQUIRE(hash(Symbol(str2)) == a2);
+  REQUIRE(hash(Symbol()) == hash(""));
 }
 
 const char letters[24] = "abcdefghjklmnopqrstuvw";
@@ -403,3 +489,44 @@ TEST_CASE("madronalib/core/symbol/path", "[symbol][path]")
   REQUIRE(!p.beginsWith(q));
   
 }
+
+TEST_CASE("madronalib/core/symbol/path_id", "[symbol][path]")
+{
+  Path a("osc/voices/frequency");
+  Path b(Path("osc"), Path("voices/frequency"));
+  Path c("osc/voices/amplitude");
+
+  REQUIRE(hash(a) == hash(b));
+  REQUIRE(hash(a) != hash(c));
+
+  // equal paths get the same ID, and the path can be recovered from it.
+  PathID ia(a), ib(b), ic(c);
+  REQUIRE(ia == ib);
+  REQUIRE(ia != ic);
+  REQUIRE(ia.getPath() == a);
+  REQUIRE(!PathID());
+  REQUIRE(!PathID(Path()));
+  REQUIRE(PathID().getPath() == Path());
+
+  // many paths, from several threads at once.
+  std::vector<std::thread> threads;
+  std::atomic<bool> allOK{true};
+  for (int t = 0; t < 4; ++t)
+  {
+    threads.push_back(std::thread([&allOK]() {
+      for (int i = 0; i < 5000; ++i)
+      {
+        Path p(Path("params"), Path(textUtils::addFinalNumber(Symbol("p"), i)));
+        PathID id(p);
+        if ((id.getPath() != p) || (PathID(p) != id)) allOK = false;
+      }
+    }));
+  }
+  for (auto& t : threads) t.join();
+  REQUIRE(allOK);
+  REQUIRE(ia.getPath() == a);
+
+  std::unordered_map<PathID, int> pathMap;
+  pathMap[ia] = 1;
+  REQUIRE(pathMap[PathID(b)] == 1);
+}
@@ -67,3 +67,132 @@ TEST_CASE("madronalib/core/text", "[text]")
   REQUIRE(textUtils::stripExtension(footxt) == "foo");
   REQUIRE(textUtils::getExtension(footxt) == "txt");
 }
+
+TEST_CASE("madronalib/core/text/utf8", "[text]")
+{
+  // one, two, three and four byte code points, with an ASCII run long enough
+  // for the fast paths.
+  const char* mixed("\x24\xC2\xA2\xE2\x82\xAC\xF0\x90\x8D\x88 and some ASCII text \xE5\xB0\x8F!");
+  std::vector<CodePoint> expected{0x24, 0xA2, 0x20AC, 0x10348};
+  for (auto c : TextFragment(" and some ASCII text ")) expected.push_back(c);
+  expected.push_back(0x5C0F);
+  expected.push_back('!');
+
+  TextFragment t(mixed);
+  std::vector<CodePoint> points;
+  for (auto it = t.begin(); it != t.end(); ++it)
+  {
+    points.push_back(*it);
+  }
+  REQUIRE(points == expected);
+  REQUIRE(t.lengthInCodePoints() == expected.size());
+  REQUIRE(codePointsToText(points) == t);
+
+  // iterators are values.
+  auto a = t.begin();
+  auto b = a;
+  ++b;
+  REQUIRE(a != b);
+  a = b;
+  REQUIRE(*a == 0xA2);
+
+  REQUIRE(validateUTF8(mixed, strlen(mixed)));
+  REQUIRE(validateUTF8("", 0));
+  REQUIRE(!validateUTF8("\x80", 1));
+  REQUIRE(!validateUTF8("abc\xE2\x82", 5));
+  REQUIRE(!validateUTF8("\xC0\xAF", 2));
+  REQUIRE(!validateUTF8("\xED\xA0\x80", 3));
+  REQUIRE(!validateUTF8("\xF4\x90\x80\x80", 4));
+  REQUIRE(asciiPrefixLength("0123456789abcdef\xC2\xA2", 18) == 16);
+
+  // text utilities give the same results on ASCII and non-ASCII text.
+  TextFragment ascii("path/to/some/file.txt");
+  TextFragment wide("path/to/\xE5\xB0\x8F/file.txt");
+  REQUIRE(textUtils::findFirst(ascii, '/') == 4);
+  REQUIRE(textUtils::findLast(ascii, '/') == 12);
+  REQUIRE(textUtils::findLast(wide, '/') == 9);
+  REQUIRE(textUtils::findFirst(ascii, 'z') == -1);
+  REQUIRE(textUtils::subText(ascii, 5, 7) == "to");
+  REQUIRE(textUtils::subText(wide, 8, 9) == TextFragment("\xE5\xB0\x8F"));
+  REQUIRE(textUtils::subText(ascii, 13, 100) == "file.txt");
+  REQUIRE(textUtils::subText(wide, 10, 100) == "file.txt");
+  REQUIRE(textUtils::subText(ascii, 100, 200) == TextFragment());
+  auto asciiPieces = textUtils::split(ascii, '/');
+  auto widePieces = textUtils::split(wide, '/');
+  REQUIRE(asciiPieces.size() == 4);
+  REQUIRE(widePieces.size() == 4);
+  REQUIRE(widePieces[2] == TextFragment("\xE5\xB0\x8F"));
+  REQUIRE(asciiPieces[3] == widePieces[3]);
+  REQUIRE(textUtils::split(TextFragment("\xE5\xB0\x8F/a//b/"), '/').size() == 3);
+  REQUIRE(textUtils::getShortFileName(wide) == "file.txt");
+}
+
+TEST_CASE("madronalib/core/text/builder", "[text]")
+{
+  TextBuilder b;
+  b.append("hello").append(',').append(TextFragment(" world"));
+  REQUIRE(b.getText() == "hello, world");
+  REQUIRE(b.lengthInBytes() == 12);
+
+  // grow past the local buffer.
+  b.clear();
+  std::vector<TextFragment> words;
+  for (int i = 0; i < 200; ++i)
+  {
+    words.push_back(textUtils::naturalNumberToText(i));
+    b.append(words.back());
+    b.append(0x5C0F);
+  }
+  auto longText = b.getText();
+  REQUIRE(longText.lengthInCodePoints() == 490 + 200);
+  REQUIRE(textUtils::split(longText, 0x5C0F) == words);
+  REQUIRE(textUtils::join(words, 0x5C0F) == textUtils::subText(longText, 0, 689));
+
+  // taking the text hands over the builder's buffer, so a reserved build
+  // makes one allocation in total.
+  auto poolInUse = []() {
+    size_t sum{0};
+    for (auto& s : theMemoryPool().getStats().sizeClasses) sum += s.inUse;
+    return sum;
+  };
+  size_t inUseBefore = poolInUse();
+  {
+    TextBuilder rb;
+    rb.reserve(300);
+    for (int i = 0; i < 100; ++i) rb.append("abc");
+    REQUIRE(poolInUse() == inUseBefore + 1);
+    auto taken = std::move(rb).takeText();
+    REQUIRE(poolInUse() == inUseBefore + 1);
+    REQUIRE(taken.lengthInBytes() == 300);
+    REQUIRE(taken.getText()[300] == 0);
+    REQUIRE(textUtils::subText(taken, 297, 300) == "abc");
+    REQUIRE(rb.lengthInBytes() == 0);
+  }
+  REQUIRE(poolInUse() == inUseBefore);
+
+  // a failed allocation is reported, and no truncated text is returned.
+  TextBuilder fb;
+  fb.append("start");
+  fb.append("x", size_t(1) << 60);
+  REQUIRE(!fb.ok());
+  fb.append("more");
+  REQUIRE(fb.getText() == TextFragment());
+  REQUIRE(std::move(fb).takeText() == TextFragment());
+  REQUIRE(fb.ok());
+
+  // build in caller-supplied memory.
+  char arena[16];
+  TextBuilder ab(arena, sizeof(arena));
+  ab.append("0123456789");
+  REQUIRE(std::string(arena, 10) == "0123456789");
+  ab.append("abcdefghij");
+  REQUIRE(ab.getText() == "0123456789abcdefghij");
+
+  // paths
+  Path p("a/b/c");
+  REQUIRE(pathToText(p) == "a/b/c");
+  REQUIRE(rootPathToText(p) == "/a/b/c");
+  REQUIRE(pathToText(Path()) == TextFragment());
+  REQUIRE(textUtils::replace(TextFragment("a/b/c"), '/', 0x5C0F) ==
+          TextFragment("a\xE5\xB0\x8F" "b\xE5\xB0\x8F" "c"));
+}
@@ -404,6 +404,272 @@ TEST_CASE("madronalib/core/tree", "[tree]")
   
 }
 
+TEST_CASE("madronalib/core/tree/flat", "[tree]")
+{
+  // make random paths and values as in the tree test above
+  const int numTestWords = 20;
+  auto testWords = ml::textUtils::vectorOfNonsenseSymbols(numTestWords);
+  RandomScalarSource randSource;
+  Tree<int> tree;
+  FlatTree<int> flatTree;
+  for (int i = 1; i < 1000; ++i)
+  {
+    int pathDepth = ((randSource.getUInt32() >> 16) & 0x07) + 1;
+    Path p;
+    for (int j = 0; j < pathDepth; ++j)
+    {
+      p = Path{p, testWords[(randSource.getUInt32() >> 16) % numTestWords]};
+    }
+    tree.add(p, i);
+    flatTree.add(p, i);
+  }
+
+  // iteration should visit the same values in the same order, with the same
+  // depths and paths.
+  auto sameAsTree = [&](const FlatTree<int>& ft, const Tree<int>& t) {
+    auto itA = ft.begin();
+    auto itB = t.begin();
+    for (; (itA != ft.end()) && (itB != t.end()); ++itA, ++itB)
+    {
+      if (*itA != *itB) return false;
+      if (itA.getCurrentDepth() != itB.getCurrentDepth()) return false;
+      if (itA.getCurrentPath() != itB.getCurrentPath()) return false;
+      if (ft[itA.getCurrentPath()] != *itA) return false;
+    }
+    return (itA == ft.end()) && (itB == t.end()) && (ft.size() == t.size());
+  };
+  REQUIRE(sameAsTree(flatTree, tree));
+
+  // node pointers stay valid while other nodes are added.
+  Path nodePath{testWords[0], testWords[1]};
+  tree.add(nodePath, 1000);
+  auto pNode = flatTree.add(nodePath, 1000);
+  for (int i = 0; i < 1000; ++i)
+  {
+    Path p{"more", testWords[i % numTestWords], textUtils::naturalNumberToText(i)};
+    flatTree.add(p, i);
+    tree.add(p, i);
+  }
+  REQUIRE(flatTree.getNode(nodePath) == pNode);
+  REQUIRE(pNode->getValue() == 1000);
+  REQUIRE(sameAsTree(flatTree, tree));
+
+  // erase subtrees from both trees
+  for (int i = 0; i < numTestWords; i += 3)
+  {
+    tree.erase(Path{testWords[i], testWords[(i * 7) % numTestWords]});
+    flatTree.erase(Path{testWords[i], testWords[(i * 7) % numTestWords]});
+    tree.erase(testWords[i + 1]);
+    flatTree.erase(testWords[i + 1]);
+  }
+  tree.erase("more/nothing");
+  flatTree.erase("more/nothing");
+  REQUIRE(!flatTree.getNode(testWords[1]));
+  REQUIRE(!tree.getNode(testWords[1]));
+  REQUIRE(sameAsTree(flatTree, tree));
+
+  // copies compare by value.
+  auto copy = flatTree;
+  REQUIRE(copy == flatTree);
+  flatTree.add("more/again", 1);
+  REQUIRE(copy != flatTree);
+  flatTree.erase("more");
+  REQUIRE(!flatTree.getConstNode("more"));
+  tree.erase("more");
+  REQUIRE(sameAsTree(flatTree, tree));
+
+  flatTree.erase(Path());
+  REQUIRE(flatTree.size() == 0);
+  REQUIRE(flatTree.begin() == flatTree.end());
+
+  // iterate just over children.
+  FlatTree<int> a;
+  a.add("case/sensitive/a", 1);
+  a.add("case/sensitive/b", 2);
+  a.add("case/sensitive/B", 3);
+  a.add("case/sensitive/c", 4);
+  a.add("case/sensitive/c/d", 5);
+  a.add("peter", 6);
+  int sumOfChildren{0};
+  auto iterator = a.begin();
+  iterator.setCurrentPath("case/sensitive");
+  for (iterator.firstChild(); iterator.hasMoreChildren(); iterator.nextChild())
+  {
+    if (iterator.currentNodeHasValue())
+    {
+      sumOfChildren += *iterator;
+    }
+  }
+  REQUIRE(sumOfChildren == 10);
+  REQUIRE(!iterator.setCurrentPath("case/insensitive"));
+
+  // FlatTree of Values, and of unique_ptrs
+  FlatTree<Value> properties;
+  properties.add("size", "big");
+  properties["corners"] = 4;
+  REQUIRE(properties["corners"] == Value(4));
+  REQUIRE(properties["nowhere/in/path"] == Value());
+
+  FlatTree<std::unique_ptr<TestResource> > heavies;
+  heavies["x"] = std::make_unique<TestResource>(10);
+  heavies.add("y/z", std::make_unique<TestResource>(4));
+  REQUIRE(TestResource::instances == 2);
+  heavies.erase("y");
+  REQUIRE(TestResource::instances == 1);
+  heavies.clear();
+  REQUIRE(TestResource::instances == 0);
+}
+
+TEST_CASE("madronalib/core/tree/persistent", "[tree]")
+{
+  const int numTestWords = 20;
+  auto testWords = ml::textUtils::vectorOfNonsenseSymbols(numTestWords);
+  Tree<Value> tree;
+  PersistentTree<Value> a;
+  for (int i = 1; i < 1000; ++i)
+  {
+    Path p{testWords[i % numTestWords], testWords[(i / numTestWords) % numTestWords],
+           textUtils::naturalNumberToText(i)};
+    tree.add(p, i);
+    a.add(p, i);
+  }
+  REQUIRE(a.size() == 999);
+  REQUIRE(a == PersistentTree<Value>(tree));
+  REQUIRE(a.toTree() == tree);
+
+  // a snapshot shares all of its nodes until one of the trees is changed.
+  auto b = a.snapshot();
+  REQUIRE(b.isSameSnapshot(a));
+  Path changed{testWords[3], testWords[0], "3"};
+  Path unchanged{testWords[4], testWords[0], "4"};
+  b[changed] = 300;
+  b.add("new/value", "hello");
+  b.erase(testWords[5]);
+  REQUIRE(!b.isSameSnapshot(a));
+  REQUIRE(a[changed] == Value(3));
+  REQUIRE(b[changed] == Value(300));
+  REQUIRE(a.getConstNode(testWords[5]));
+  REQUIRE(!b.getConstNode(testWords[5]));
+  REQUIRE(a.getConstNode(unchanged) == b.getConstNode(unchanged));
+  REQUIRE(a.getConstNode(butLast(changed)) != b.getConstNode(butLast(changed)));
+
+  // the changes between snapshots are found in tree order.
+  auto changes = getChanges(a, b);
+  REQUIRE(changes.size() == 52);
+  REQUIRE(changes[0].name == changed);
+  REQUIRE(changes[0].oldValue == Value(3));
+  REQUIRE(changes[0].newValue == Value(300));
+  REQUIRE(changes.back().name == Path("new/value"));
+  REQUIRE(changes.back().oldValue == Value());
+
+  // applying the changes to a copy of the old tree gives the new tree.
+  auto c = a;
+  for (auto& change : changes)
+  {
+    c[change.name] = change.newValue;
+  }
+  REQUIRE(c == b);
+  REQUIRE(getChanges(c, b).empty());
+  REQUIRE(getChanges(b, b).empty());
+
+  // iteration matches Tree.
+  tree.add(changed, 300);
+  tree.add("new/value", "hello");
+  tree.erase(testWords[5]);
+  auto itA = b.begin();
+  auto itB = tree.begin();
+  bool sameAsTree{true};
+  for (; (itA != b.end()) && (itB != tree.end()); ++itA, ++itB)
+  {
+    sameAsTree &= (*itA == *itB);
+    sameAsTree &= (itA.getCurrentPath() == itB.getCurrentPath());
+    sameAsTree &= (itA.getCurrentDepth() == itB.getCurrentDepth());
+  }
+  REQUIRE(sameAsTree);
+  REQUIRE(itA == b.end());
+  REQUIRE(itB == tree.end());
+
+  PersistentTree<Value> empty;
+  REQUIRE(empty.begin() == empty.end());
+  REQUIRE(empty["nowhere"] == Value());
+  REQUIRE(getChanges(empty, a).size() == 999);
+
+  // PropertyTree copies share their properties.
+  PropertyTree props{{"size", "big"}, {"corners", 4}};
+  PropertyTree props2 = props;
+  props2.setProperty("corners", 5);
+  REQUIRE(props.getIntProperty("corners") == 4);
+  REQUIRE(props2.getIntProperty("corners") == 5);
+  auto propChanges = props.getChangesTo(props2);
+  REQUIRE(propChanges.size() == 1);
+  REQUIRE(propChanges[0].name == Path("corners"));
+}
+
+TEST_CASE("madronalib/core/value", "[value]")
+{
+  REQUIRE(sizeof(Value) <= 32);
+
+  // scalar types
+  REQUIRE(Value(3).getIntValue() == 3);
+  REQUIRE(Value(0.5f).getFloatValue() == 0.5f);
+  REQUIRE(Value(uint32_t(7)).getUnsignedLongValue() == 7);
+  REQUIRE(Value(uint32_t(7)).getFloatValue() == 0.f);
+  REQUIRE((Value(Interval{1, 2}).getIntervalValue() == Interval{1, 2}));
+  REQUIRE(Value("text").getFloatValueWithDefault(2.f) == 2.f);
+
+  // short and long text
+  Text longText("a long piece of text that will not fit in the Value itself.");
+  Value shortTextValue("short");
+  Value longTextValue(longText);
+  REQUIRE(shortTextValue.getTextValue() == Text("short"));
+  REQUIRE(longTextValue.getTextValue() == longText);
+  REQUIRE(longTextValue == Value(longText));
+  REQUIRE(longTextValue != shortTextValue);
+
+  // copy and move
+  Value a(longTextValue);
+  REQUIRE(a == longTextValue);
+  Value b(std::move(a));
+  REQUIRE(b.getTextValue() == longText);
+  REQUIRE(!a);
+  a = std::move(b);
+  REQUIRE(a.getTextValue() == longText);
+  a = shortTextValue;
+  REQUIRE(a.getTextValue() == Text("short"));
+  a = a;
+  REQUIRE(a.getTextValue() == Text("short"));
+
+  // blobs of the same size are copied in place.
+  std::vector<uint8_t> bytes(1000);
+  std::iota(bytes.begin(), bytes.end(), 0);
+  Value blob(bytes.data(), bytes.size());
+  const void* pBlobData = blob.getBlobValue();
+  bytes[999] = 3;
+  Value blob2(bytes.data(), bytes.size());
+  blob = blob2;
+  REQUIRE(blob.getBlobValue() == pBlobData);
+  REQUIRE(blob.getBlobSize() == 1000);
+  REQUIRE(static_cast<uint8_t*>(blob.getBlobValue())[999] == 3);
+
+  // matrices
+  Value m{1, 2, 3, 4};
+  REQUIRE(m.getType() == Value::kMatrixValue);
+  Value m2 = m;
+  REQUIRE(m2.getMatrixValue() == m.getMatrixValue());
+  m2 = 5.f;
+  REQUIRE(m2.getMatrixValue() == Value::nullMatrix);
+  REQUIRE(m.getMatrixValue()[3] == 4.f);
+
+  // a tree of all the types converted to binary and back should be unchanged.
+  Tree<Value> t;
+  t["short"] = shortTextValue;
+  t["long"] = longTextValue;
+  t["float"] = 2.f;
+  t["matrix"] = m;
+  t["ul"] = uint32_t(12);
+  REQUIRE(binaryToValueTree(valueTreeToBinary(t)) == t);
+}
+
 TEST_CASE("madronalib/core/serialization", "[serialization]")
 {
   NoiseGen n;
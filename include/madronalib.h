@@ -7,9 +7,12 @@
 #include "MLActor.h"
 #include "MLClock.h"
 #include "MLEventsToSignals.h"
+#include "MLFlatTree.h"
+#include "MLMemoryPool.h"
 #include "MLMemoryUtils.h"
 #include "MLParameters.h"
 #include "MLPath.h"
+#include "MLPersistentTree.h"
 #include "MLPlatform.h"
 #include "MLPropertyTree.h"
 #include "MLQueue.h"
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <limits>
 #include <vector>
 
 #include "MLDSPOps.h"
@@ -29,6 +31,17 @@ namespace ml
 // use this, not dBToAmp for calculating filter gain parameter A.
 inline float dBToGain(float dB) { return powf(10.f, dB / 40.f); }
 
+// when a linear filter has zero input and all its state variables are smaller
+// than this, its output is inaudible. The filter can then flush its state to
+// zero and return zeroes without running, until it has some input again.
+constexpr float kFilterSilenceThreshold{1e-9f};
+
+inline bool filterStateIsSilent(float a) { return fabsf(a) < kFilterSilenceThreshold; }
+inline bool filterStateIsSilent(float a, float b)
+{
+  return filterStateIsSilent(a) && filterStateIsSilent(b);
+}
+
 // from a coefficients start array and a coefficients end array, make a
 // DSPVectorArray with each coefficient interpolated over time.
 template <size_t COEFFS_SIZE>
@@ -67,6 +80,9 @@ struct Lopass
     ic1eq = 0;
     ic2eq = 0;
   }
+
+  // true if the filter has decayed to silence.
+  inline bool isSilent() const { return filterStateIsSilent(ic1eq, ic2eq); }
   
   enum paramNames
   {
@@ -117,6 +133,11 @@ struct Lopass
   // filter the input vector vx with the stored coefficients.
   inline DSPVector operator()(const DSPVector vx)
   {
+    if (isZero(vx) && isSilent())
+    {
+      clear();
+      return DSPVector(0.f);
+    }
     DSPVector vy;
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
@@ -135,6 +156,11 @@ struct Lopass
   // filter the input vector vx with the coefficients generated from parameters omega and k.
   inline DSPVector operator()(const DSPVector vx, const DSPVector omega, const DSPVector k)
   {
+    if (isZero(vx) && isSilent())
+    {
+      clear();
+      return DSPVector(0.f);
+    }
     DSPVector vy;
     auto vc = makeCoeffsVec(omega, k);
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
@@ -167,6 +193,15 @@ class Hipass
  public:
   _coeffs mCoeffs{0};
 
+  inline void clear()
+  {
+    ic1eq = 0;
+    ic2eq = 0;
+  }
+
+  // true if the filter has decayed to silence.
+  inline bool isSilent() const { return filterStateIsSilent(ic1eq, ic2eq); }
+
   static _coeffs coeffs(float omega, float k)
   {
     float piOmega = kPi * omega;
@@ -181,6 +216,11 @@ class Hipass
 
   inline DSPVector operator()(const DSPVector vx)
   {
+    if (isZero(vx) && isSilent())
+    {
+      clear();
+      return DSPVector(0.f);
+    }
     DSPVector vy;
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
@@ -211,6 +251,15 @@ class Bandpass
  public:
   _coeffs mCoeffs{0};
 
+  inline void clear()
+  {
+    ic1eq = 0;
+    ic2eq = 0;
+  }
+
+  // true if the filter has decayed to silence.
+  inline bool isSilent() const { return filterStateIsSilent(ic1eq, ic2eq); }
+
   static _coeffs coeffs(float omega, float k)
   {
     float piOmega = kPi * omega;
@@ -225,6 +274,11 @@ class Bandpass
 
   inline DSPVector operator()(const DSPVector vx)
   {
+    if (isZero(vx) && isSilent())
+    {
+      clear();
+      return DSPVector(0.f);
+    }
     DSPVector vy;
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
@@ -269,6 +323,15 @@ class LoShelf
   typedef std::array<float, PARAMS_SIZE> params;
   _coeffs mCoeffs{};
 
+  inline void clear()
+  {
+    ic1eq = 0;
+    ic2eq = 0;
+  }
+
+  // true if the filter has decayed to silence.
+  inline bool isSilent() const { return filterStateIsSilent(ic1eq, ic2eq); }
+
   static _coeffs coeffs(params p)
   {
     _coeffs r;
@@ -289,6 +352,11 @@ class LoShelf
 
   inline DSPVector operator()(const DSPVector vx)
   {
+    if (isZero(vx) && isSilent())
+    {
+      clear();
+      return DSPVector(0.f);
+    }
     DSPVector vy;
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
@@ -349,6 +417,15 @@ class HiShelf
   typedef std::array<float, PARAMS_SIZE> params;
   _coeffs mCoeffs{};
 
+  inline void clear()
+  {
+    ic1eq = 0;
+    ic2eq = 0;
+  }
+
+  // true if the filter has decayed to silence.
+  inline bool isSilent() const { return filterStateIsSilent(ic1eq, ic2eq); }
+
   static _coeffs coeffs(params p)
   {
     _coeffs r;
@@ -370,6 +447,11 @@ class HiShelf
 
   inline DSPVector operator()(const DSPVector vx)
   {
+    if (isZero(vx) && isSilent())
+    {
+      clear();
+      return DSPVector(0.f);
+    }
     DSPVector vy;
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
@@ -414,6 +496,15 @@ class Bell
  public:
   _coeffs mCoeffs{0};
 
+  inline void clear()
+  {
+    ic1eq = 0;
+    ic2eq = 0;
+  }
+
+  // true if the filter has decayed to silence.
+  inline bool isSilent() const { return filterStateIsSilent(ic1eq, ic2eq); }
+
   static _coeffs coeffs(float omega, float k, float A)
   {
     float kc = k / A;  // correct k
@@ -428,6 +519,11 @@ class Bell
 
   inline DSPVector operator()(const DSPVector vx)
   {
+    if (isZero(vx) && isSilent())
+    {
+      clear();
+      return DSPVector(0.f);
+    }
     DSPVector vy;
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
@@ -465,8 +561,16 @@ struct OnePole
 
   static _coeffs passthru() { return {1.f, 0.f}; }
 
+  // true if the filter has decayed to silence.
+  inline bool isSilent() const { return filterStateIsSilent(y1); }
+
   inline DSPVector operator()(const DSPVector vx)
   {
+    if (isZero(vx) && isSilent())
+    {
+      reset(0.f);
+      return DSPVector(0.f);
+    }
     DSPVector vy;
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
@@ -500,8 +604,22 @@ class DCBlocker
 
   static _coeffs coeffs(float omega) { return cosf(omega); }
 
+  inline void clear()
+  {
+    x1 = 0;
+    y1 = 0;
+  }
+
+  // true if the filter has decayed to silence.
+  inline bool isSilent() const { return filterStateIsSilent(x1, y1); }
+
   inline DSPVector operator()(const DSPVector vx)
   {
+    if (isZero(vx) && isSilent())
+    {
+      clear();
+      return DSPVector(0.f);
+    }
     DSPVector vy;
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
@@ -655,6 +773,171 @@ class RMS
   }
 };
 
+// Sliding window filters: exact minimum, maximum or sum over the most recent
+// windowSize samples, for lookahead limiters, true peak meters and so on.
+//
+// These use the block decomposition of van Herk / Gil-Werman: the input is cut
+// into blocks the length of the window, so any window spans the end of the
+// previous block and the start of the current one. The result is the
+// combination of a suffix of the previous block, computed with one backwards
+// scan when that block is complete, and a running prefix of the current block.
+// That costs three operations per sample regardless of the window size, and
+// there is no accumulated rounding error in the sums. The combining step runs
+// on SIMD vectors. Input before the first sample is considered to be zero.
+
+namespace slidingWindowOps
+{
+struct Max
+{
+  static constexpr float identity() { return std::numeric_limits<float>::lowest(); }
+  static float apply(float a, float b) { return std::max(a, b); }
+  static SIMDVectorFloat apply(SIMDVectorFloat a, SIMDVectorFloat b) { return vecMax(a, b); }
+};
+
+struct Min
+{
+  static constexpr float identity() { return std::numeric_limits<float>::max(); }
+  static float apply(float a, float b) { return std::min(a, b); }
+  static SIMDVectorFloat apply(SIMDVectorFloat a, SIMDVectorFloat b) { return vecMin(a, b); }
+};
+
+struct Sum
+{
+  static constexpr float identity() { return 0.f; }
+  static float apply(float a, float b) { return a + b; }
+  static SIMDVectorFloat apply(SIMDVectorFloat a, SIMDVectorFloat b) { return vecAdd(a, b); }
+};
+}  // namespace slidingWindowOps
+
+template <typename OP>
+class SlidingWindow
+{
+  // the current block, and the suffixes of the previous one. _suffix has one
+  // extra element at the end containing the identity of OP.
+  std::vector<float> _block;
+  std::vector<float> _suffix;
+  size_t _windowSize{0};
+  size_t _pos{0};
+  float _run{0};
+
+  void computeSuffix()
+  {
+    float acc = OP::identity();
+    for (size_t k = _windowSize; k > 0; --k)
+    {
+      acc = OP::apply(_block[k - 1], acc);
+      _suffix[k - 1] = acc;
+    }
+  }
+
+ public:
+  SlidingWindow() { setWindowInSamples(1); }
+  SlidingWindow(size_t w) { setWindowInSamples(w); }
+  ~SlidingWindow() = default;
+
+  // allocates memory, so call this before processing.
+  void setWindowInSamples(size_t w)
+  {
+    _windowSize = std::max(w, size_t(1));
+    _block.resize(_windowSize);
+    _suffix.resize(_windowSize + 1);
+    clear();
+  }
+
+  size_t getWindowInSamples() const { return _windowSize; }
+
+  void clear()
+  {
+    std::fill(_block.begin(), _block.end(), 0.f);
+    computeSuffix();
+    _suffix[_windowSize] = OP::identity();
+    _pos = 0;
+    _run = 0.f;
+  }
+
+  inline DSPVector operator()(const DSPVector vx)
+  {
+    DSPVector vPrefix;
+    DSPVector vy;
+    const float* px = vx.getConstBuffer();
+    float* pPrefix = vPrefix.getBuffer();
+    float* py = vy.getBuffer();
+
+    size_t i0 = 0;
+    while (i0 < kFloatsPerDSPVector)
+    {
+      // process a segment of input up to the end of the vector or current block.
+      const size_t n = std::min(kFloatsPerDSPVector - i0, _windowSize - _pos);
+      const float* pSuffix = _suffix.data() + _pos + 1;
+
+      // running prefix of the current block.
+      for (size_t i = i0; i < i0 + n; ++i)
+      {
+        _run = (_pos == 0) ? px[i] : OP::apply(_run, px[i]);
+        _block[_pos++] = px[i];
+        pPrefix[i] = _run;
+      }
+
+      // combine the prefixes with the suffixes of the previous block.
+      size_t i = 0;
+      for (; i + kFloatsPerSIMDVector <= n; i += kFloatsPerSIMDVector)
+      {
+        SIMDVectorFloat vs = vecLoadUnaligned(pSuffix + i);
+        SIMDVectorFloat vp = vecLoadUnaligned(pPrefix + i0 + i);
+        vecStoreUnaligned(py + i0 + i, OP::apply(vs, vp));
+      }
+      for (; i < n; ++i)
+      {
+        py[i0 + i] = OP::apply(pSuffix[i], pPrefix[i0 + i]);
+      }
+
+      // at the end of a block, get its suffixes for the next one.
+      if (_pos == _windowSize)
+      {
+        computeSuffix();
+        _pos = 0;
+      }
+      i0 += n;
+    }
+    return vy;
+  }
+};
+
+using SlidingMax = SlidingWindow<slidingWindowOps::Max>;
+using SlidingMin = SlidingWindow<slidingWindowOps::Min>;
+using SlidingSum = SlidingWindow<slidingWindowOps::Sum>;
+
+// maximum absolute value over the window.
+class SlidingPeak
+{
+  SlidingMax _max;
+
+ public:
+  void setWindowInSamples(size_t w) { _max.setWindowInSamples(w); }
+  void clear() { _max.clear(); }
+  inline DSPVector operator()(const DSPVector vx) { return _max(abs(vx)); }
+};
+
+// exact RMS value over the window.
+class SlidingRMS
+{
+  SlidingSum _sum;
+  float _gain{1.f};
+
+ public:
+  void setWindowInSamples(size_t w)
+  {
+    _sum.setWindowInSamples(w);
+    _gain = 1.f / _sum.getWindowInSamples();
+  }
+  void clear() { _sum.clear(); }
+  inline DSPVector operator()(const DSPVector vx)
+  {
+    // clamp to 0, because rounding can make sums of positive values negative
+    return sqrt(max(_sum(vx * vx) * DSPVector(_gain), DSPVector(0.f)));
+  }
+};
+
 // ADSR envelope triggered and scaled by a single gate + amp signal.
 
 struct ADSR
@@ -788,12 +1071,80 @@ struct ADSR
     return y*amp;
   }
   
+  static inline bool isTrigger(float xPrev, float x)
+  {
+    return ((xPrev == 0.f) && (x > 0.f)) || ((xPrev > 0.f) && (x == 0.f));
+  }
+
+  // process a run of n samples with no gate triggers in closed form:
+  // y[j] = target + (y - target)*(1 - k)^j. The run stops at the first
+  // sample that crosses the threshold, so that processSample() can advance
+  // the segment on the next sample. Returns the number of samples written.
+  inline size_t processRun(const float* px, float* py, size_t n)
+  {
+    const float p = 1.f - k;
+    const float p2 = p*p;
+    const float pows[kFloatsPerSIMDVector]{p, p2, p2*p, p2*p2};
+    SIMDVectorFloat vPow = vecLoadUnaligned(pows);
+    const SIMDVectorFloat vPow4 = vecSet1(p2*p2);
+    const SIMDVectorFloat vTarget = vecSet1(target);
+    const SIMDVectorFloat vDiff = vecSet1(y - target);
+    const SIMDVectorFloat vThresh = vecSet1(threshold);
+    const int startAbove = (y > threshold) ? 0xF : 0;
+
+    alignas(16) float env[kFloatsPerDSPVector];
+    size_t m = n;
+    for(size_t j = 0; j < n; j += kFloatsPerSIMDVector)
+    {
+      SIMDVectorFloat vEnv = vecAdd(vTarget, vecMul(vDiff, vPow));
+      vecStore(env + j, vEnv);
+      vPow = vecMul(vPow, vPow4);
+      
+      // look for the first sample on the other side of the threshold
+      int crossed = vecMoveMask(vecGreaterThan(vEnv, vThresh)) ^ startAbove;
+      if(crossed)
+      {
+        size_t c = j;
+        while(!(crossed & 1)) { crossed >>= 1; c++; }
+        m = std::min(c + 1, n);
+        break;
+      }
+    }
+    
+    for(size_t j = 0; j < m; ++j)
+    {
+      py[j] = env[j]*amp;
+    }
+    y1 = (m > 1) ? env[m - 2] : y;
+    y = env[m - 1];
+    x1 = px[m - 1];
+    return m;
+  }
+  
+  // whole stretches between gate changes and segment boundaries are computed
+  // in closed form with SIMD. Only the boundary samples use processSample().
   inline DSPVector operator()(const DSPVector vx)
   {
+    if((segment == off) && isZero(vx)) return DSPVector(0.f);
+    
     DSPVector r;
-    for(int i=0; i<kFloatsPerDSPVector; ++i)
+    const float* px = vx.getConstBuffer();
+    float* py = r.getBuffer();
+    size_t i = 0;
+    while(i < kFloatsPerDSPVector)
     {
-      r[i] = processSample(vx[i]);
+      const bool crossedThresh = ((y1 > threshold) != (y > threshold));
+      if(crossedThresh || isTrigger(x1, px[i]) || ((segment == off) && (px[i] == 0.f)))
+      {
+        py[i] = processSample(px[i]);
+        i++;
+      }
+      else
+      {
+        size_t n = 1;
+        while((i + n < kFloatsPerDSPVector) && !isTrigger(px[i + n - 1], px[i + n])) n++;
+        i += processRun(px + i, py + i, n);
+      }
     }
     return r;
   }
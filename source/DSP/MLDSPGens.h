@@ -432,6 +432,16 @@ public:
     mVectorsRemaining = 0;
   }
   
+  // true if the glide has reached its target, so that the output is constant.
+  bool isSettled() const { return mVectorsRemaining < 0; }
+  
+  // get the flags for the most recent output vector.
+  uint32_t getFlags() const
+  {
+    if (!isSettled()) return kDSPVectorNoFlags;
+    return (mTargetValue == 0.f) ? kDSPVectorZero : kDSPVectorConstant;
+  }
+  
   DSPVector operator()(float f)
   {
     // set target value if different from current value.
@@ -443,6 +453,11 @@ public:
       // start counter
       mVectorsRemaining = mVectorsPerGlide;
     }
+    else if (isSettled())
+    {
+      // nothing to do: the output is already constant at the target value.
+      return mCurrVec;
+    }
     
     // process glide
     if (mVectorsRemaining == 0)
@@ -543,6 +558,237 @@ public:
     
     return mCurrValue;
   }
+  
+  // write n samples of output with constant input f. This is equivalent to
+  // calling nextSample(f) n times, but stretches where the glide is in
+  // progress or settled are written in closed form.
+  void writeSamples(float f, float* pDest, size_t n)
+  {
+    size_t i = 0;
+    while (i < n)
+    {
+      if ((f != mTargetValue) || (mSamplesRemaining == 0) || (mSamplesRemaining == mSamplesPerGlide))
+      {
+        // start or end of glide
+        pDest[i++] = nextSample(f);
+      }
+      else if (mSamplesRemaining < 0)
+      {
+        // settled
+        for (; i < n; ++i) pDest[i] = mCurrValue;
+      }
+      else
+      {
+        // gliding
+        size_t k = std::min(n - i, static_cast<size_t>(mSamplesRemaining));
+        for (size_t j = 0; j < k; ++j) pDest[i + j] = mCurrValue + mStepValue * (j + 1);
+        mCurrValue += mStepValue * k;
+        mSamplesRemaining -= static_cast<int>(k);
+        i += k;
+      }
+    }
+  }
+};
+
+// AutomationRamps: sample-accurate linear ramps for a bank of parameters, made
+// from timestamped change points like those in host automation queues. A point
+// gives the value a parameter should reach at a sample offset from the start of
+// the next vector, and the output ramps linearly to it from the previous value.
+// Offsets may be beyond the next vector, so all the points of a larger host
+// block can be added at once before processing its vectors.
+//
+// Parameters are indexed by number, for example with the IDs of ParamHandles.
+// Only parameters with pending points or ramps in progress are processed, the
+// rest keep a constant output vector.
+
+class AutomationRamps
+{
+  struct Point
+  {
+    int64_t time;
+    float value;
+  };
+
+  struct Ramp
+  {
+    DSPVector output;
+    int64_t startTime{-1};
+    float startValue{0.f};
+    size_t firstPoint{0};
+    size_t nPoints{0};
+    bool active{false};
+  };
+
+  std::vector<Ramp> _ramps;
+  std::vector<Point> _points;
+  std::vector<size_t> _activeList;
+  size_t _maxPoints{0};
+
+  // time in samples at the start of the next vector
+  int64_t _time{0};
+
+  void activate(size_t param)
+  {
+    if (!_ramps[param].active)
+    {
+      _ramps[param].active = true;
+      _activeList.push_back(param);
+    }
+  }
+
+  // compute the next vector for one parameter. Returns true if the output
+  // will be constant from now until more points are added.
+  bool processRamp(size_t param)
+  {
+    Ramp& r = _ramps[param];
+    Point* pPoints = _points.data() + param * _maxPoints;
+    const int64_t vectorEnd = _time + kFloatsPerDSPVector;
+
+    if (r.nPoints == 0)
+    {
+      r.startTime = _time - 1;
+      r.output = DSPVector(r.startValue);
+      return true;
+    }
+
+    // typical case: one ramp segment through the whole vector.
+    {
+      const Point& p = pPoints[r.firstPoint];
+      if ((p.time >= vectorEnd - 1) && (r.startTime < _time))
+      {
+        float slope = (p.value - r.startValue) / (p.time - r.startTime);
+        float y0 = r.startValue + slope * (_time - r.startTime);
+        r.output = DSPVector(y0) + columnIndex() * DSPVector(slope);
+        if (p.time == vectorEnd - 1)
+        {
+          r.output[kFloatsPerDSPVector - 1] = p.value;
+          r.startValue = p.value;
+          r.startTime = p.time;
+          r.firstPoint = (r.firstPoint + 1) % _maxPoints;
+          r.nPoints--;
+        }
+        return false;
+      }
+    }
+
+    // otherwise, write each segment up to the next point in this vector.
+    float* py = r.output.getBuffer();
+    int64_t t = _time;
+    while (t < vectorEnd)
+    {
+      if (r.nPoints == 0)
+      {
+        for (; t < vectorEnd; ++t) py[t - _time] = r.startValue;
+        break;
+      }
+
+      const Point& p = pPoints[r.firstPoint];
+      if (p.time < t)
+      {
+        // point is in the past, jump to it.
+        r.startValue = p.value;
+        r.startTime = t - 1;
+      }
+      else
+      {
+        float slope = (p.value - r.startValue) / (p.time - r.startTime);
+        int64_t end = std::min(p.time, vectorEnd - 1);
+        for (; t < end; ++t) py[t - _time] = r.startValue + slope * (t - r.startTime);
+        if (p.time >= vectorEnd)
+        {
+          py[t - _time] = r.startValue + slope * (t - r.startTime);
+          break;
+        }
+        py[t++ - _time] = p.value;
+        r.startValue = p.value;
+        r.startTime = p.time;
+      }
+      r.firstPoint = (r.firstPoint + 1) % _maxPoints;
+      r.nPoints--;
+    }
+    return false;
+  }
+
+ public:
+  AutomationRamps() = default;
+  AutomationRamps(size_t params, size_t maxPointsPerParam = 32) { resize(params, maxPointsPerParam); }
+
+  // allocates memory, so call this before processing.
+  void resize(size_t params, size_t maxPointsPerParam = 32)
+  {
+    _maxPoints = std::max(maxPointsPerParam, size_t(1));
+    _ramps = std::vector<Ramp>(params);
+    _points.resize(params * _maxPoints);
+    _activeList.clear();
+    _activeList.reserve(params);
+    _time = 0;
+  }
+
+  size_t size() const { return _ramps.size(); }
+
+  // set the value of a parameter immediately, clearing any points.
+  void setValue(size_t param, float value)
+  {
+    if (param >= _ramps.size()) return;
+    Ramp& r = _ramps[param];
+    r.startValue = value;
+    r.startTime = _time - 1;
+    r.nPoints = 0;
+    r.output = DSPVector(value);
+  }
+
+  // add a point where the parameter reaches the value at the given offset in
+  // samples from the start of the next vector. Points for each parameter must be
+  // added in time order. If there's no room, the newest point is replaced.
+  void addPoint(size_t param, int offset, float value)
+  {
+    if (param >= _ramps.size()) return;
+    Ramp& r = _ramps[param];
+    Point* pPoints = _points.data() + param * _maxPoints;
+    Point p{_time + std::max(offset, 0), value};
+    if (r.nPoints == 0)
+    {
+      // the ramp may have been idle for a while. Start from the current
+      // value at the end of the last vector.
+      r.startTime = _time - 1;
+    }
+    if (r.nPoints < _maxPoints)
+    {
+      pPoints[(r.firstPoint + r.nPoints) % _maxPoints] = p;
+      r.nPoints++;
+    }
+    else
+    {
+      pPoints[(r.firstPoint + r.nPoints - 1) % _maxPoints] = p;
+    }
+    activate(param);
+  }
+
+  // compute the next output vector for every active parameter.
+  void process()
+  {
+    size_t n = 0;
+    for (size_t i = 0; i < _activeList.size(); ++i)
+    {
+      size_t param = _activeList[i];
+      if (processRamp(param))
+      {
+        _ramps[param].active = false;
+      }
+      else
+      {
+        _activeList[n++] = param;
+      }
+    }
+    _activeList.resize(n);
+    _time += kFloatsPerDSPVector;
+  }
+
+  // get the output of the most recent process() for a parameter.
+  const DSPVector& getRamp(size_t param) const { return _ramps[param].output; }
+
+  bool isActive(size_t param) const { return _ramps[param].active; }
+  size_t getNumActive() const { return _activeList.size(); }
 };
 
 }  // namespace ml
@@ -117,6 +117,9 @@ _mm_cmpneq_ps(_mm_set_ps1(-0.0f), x)))
 #define vecAnd _mm_and_ps
 #define vecOr _mm_or_ps
 
+// get an int with one bit set for each element of a comparison mask that is true.
+#define vecMoveMask _mm_movemask_ps
+
 #define vecZeros _mm_setzero_ps
 #define vecOnes vecEqual(vecZeros, vecZeros)
 
@@ -139,6 +142,9 @@ inline SIMDVectorFloat vecUnsignedIntToFloat(SIMDVectorInt v)
 #define vecAddInt _mm_add_epi32
 #define vecSubInt _mm_sub_epi32
 #define vecSet1Int _mm_set1_epi32
+#define vecGreaterThanInt _mm_cmpgt_epi32
+#define vecEqualInt _mm_cmpeq_epi32
+#define vecAndInt _mm_and_si128
 
 typedef union
 {
@@ -1038,6 +1038,90 @@ inline float min(const DSPVector& x)
   return fmin;
 }
 
+// ----------------------------------------------------------------
+// signal flags
+//
+// DSPVectors carry no metadata, so that rows of arrays can be freely
+// reinterpreted as DSPVectors. Instead, code that wants to skip work on silent
+// or unchanging signals can compute these flags from a vector, or propagate
+// them through a graph using the flag functions below. A zero vector is always
+// also constant.
+
+enum DSPVectorFlags : uint32_t
+{
+  kDSPVectorNoFlags = 0,
+  kDSPVectorConstant = 1 << 0,
+  kDSPVectorZero = (1 << 1) | kDSPVectorConstant
+};
+
+// is every element of the DSPVectorArray equal to 0? -0 counts as 0.
+template <size_t ROWS>
+inline bool isZero(const DSPVectorArray<ROWS>& x)
+{
+  const float* px1 = x.getConstBuffer();
+  const SIMDVectorFloat vZero = vecZeros();
+  SIMDVectorFloat vNonzero = vecZeros();
+  for (size_t n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)
+  {
+    vNonzero = vecOr(vNonzero, vecNotEqual(vecLoad(px1), vZero));
+    px1 += kFloatsPerSIMDVector;
+  }
+  return vecMoveMask(vNonzero) == 0;
+}
+
+// is each row of the DSPVectorArray constant over time?
+template <size_t ROWS>
+inline bool isConstant(const DSPVectorArray<ROWS>& x)
+{
+  const float* px1 = x.getConstBuffer();
+  SIMDVectorFloat vDiff = vecZeros();
+  for (size_t j = 0; j < ROWS; ++j)
+  {
+    const SIMDVectorFloat vFirst = vecSet1(px1[0]);
+    for (int n = 0; n < kSIMDVectorsPerDSPVector; ++n)
+    {
+      vDiff = vecOr(vDiff, vecNotEqual(vecLoad(px1), vFirst));
+      px1 += kFloatsPerSIMDVector;
+    }
+  }
+  return vecMoveMask(vDiff) == 0;
+}
+
+template <size_t ROWS>
+inline uint32_t getFlags(const DSPVectorArray<ROWS>& x)
+{
+  if (isZero(x)) return kDSPVectorZero;
+  if (isConstant(x)) return kDSPVectorConstant;
+  return kDSPVectorNoFlags;
+}
+
+// flag propagation: given the flags of the operands, get the flags of the
+// result of the corresponding DSPVector operation without looking at the data.
+// These are conservative: a result may be constant or zero without the flag
+// being set, but never the other way around. NaN and infinity are ignored.
+
+// add, subtract, min, max, lerp and so on: the result is zero if all operands
+// are zero, constant if all operands are constant.
+inline uint32_t combineFlags(uint32_t a, uint32_t b) { return a & b; }
+
+// multiply: a zero operand makes the result zero.
+inline uint32_t multiplyFlags(uint32_t a, uint32_t b)
+{
+  uint32_t z = ((a | b) & kDSPVectorZero) == kDSPVectorZero ? kDSPVectorZero : kDSPVectorNoFlags;
+  return (a & b) | z;
+}
+
+// divide: a zero numerator makes the result zero.
+inline uint32_t divideFlags(uint32_t a, uint32_t b)
+{
+  return (a & b) | ((a == kDSPVectorZero) ? kDSPVectorZero : kDSPVectorNoFlags);
+}
+
+// unary operators: a constant input makes a constant output. Zero is
+// preserved only by operators with f(0) = 0, such as abs or sqrt.
+inline uint32_t unaryFlags(uint32_t a) { return a & kDSPVectorConstant; }
+inline uint32_t zeroPreservingUnaryFlags(uint32_t a) { return a; }
+
 // ----------------------------------------------------------------
 // normalize
 
@@ -36,7 +36,7 @@ namespace ml
 /*
 Mixer
 Switcher
- ProcessFader - SmoothSwitcher -
+ ProcessFader - SmoothSwitcher - done, see ProcessFader below
 Panner
 Gate
 Switch
@@ -233,6 +233,125 @@ void demultiplexLinear(DSPVector selector, DSPVectorArray<ROWS> input,
   }
 }
 
+// ProcessFader: switch smoothly between the outputs of a number of processing
+// branches, such as different filter types or oscillator modes. Each branch is
+// a callable object returning a DSPVectorArray<ROWS>. In steady state only the
+// selected branch is run. When the selection changes, the incoming branch is
+// first run for a number of warmup vectors with its output discarded, so that
+// any state it has can catch up with the current input. Then both branches are
+// run while the output is crossfaded linearly from one to the other. If the
+// selection changes again during a switch, the new selection is handled when
+// the current switch is done.
+//
+// example:
+// ProcessFader<1> fader;
+// DSPVector y = fader(mode, [&]() { return lopass(x); }, [&]() { return hipass(x); });
+
+template <size_t ROWS>
+class ProcessFader
+{
+  enum FaderState
+  {
+    kSteady,
+    kWarmup,
+    kFading
+  };
+
+  int _current{0};
+  int _next{0};
+  int _state{kSteady};
+  int _counter{0};
+  int _warmupVectors{1};
+  int _fadeVectors{4};
+
+  // call branch i of the given callables, where i is only known at runtime.
+  template <typename Fn>
+  static DSPVectorArray<ROWS> callBranch(int /*i*/, Fn&& fn)
+  {
+    return fn();
+  }
+
+  template <typename Fn, typename... Fns>
+  static DSPVectorArray<ROWS> callBranch(int i, Fn&& fn, Fns&&... fns)
+  {
+    return (i <= 0) ? fn() : callBranch(i - 1, std::forward<Fns>(fns)...);
+  }
+
+ public:
+  // the fade time is quantized to whole DSPVectors, with a minimum of one.
+  void setFadeTimeInSamples(float t)
+  {
+    _fadeVectors = ml::max(1, static_cast<int>(t / kFloatsPerDSPVector));
+  }
+
+  // set the number of vectors an incoming branch runs silently before fading in.
+  void setWarmupTimeInSamples(float t)
+  {
+    _warmupVectors = ml::max(0, static_cast<int>(t / kFloatsPerDSPVector));
+  }
+
+  // jump to the given branch immediately without fading.
+  void setBranch(int b)
+  {
+    _current = _next = b;
+    _state = kSteady;
+  }
+
+  int getBranch() const { return _current; }
+
+  // true while more than one branch is being run.
+  bool isSwitching() const { return _state != kSteady; }
+
+  template <typename... Fns>
+  DSPVectorArray<ROWS> operator()(int selection, Fns&&... branches)
+  {
+    constexpr int nBranches = sizeof...(Fns);
+    selection = ml::clamp(selection, 0, nBranches - 1);
+
+    if ((_state == kSteady) && (selection != _current))
+    {
+      _next = selection;
+      _state = (_warmupVectors > 0) ? kWarmup : kFading;
+      _counter = 0;
+    }
+
+    switch (_state)
+    {
+      case kSteady:
+      default:
+      {
+        return callBranch(_current, std::forward<Fns>(branches)...);
+      }
+      case kWarmup:
+      {
+        callBranch(_next, std::forward<Fns>(branches)...);
+        if (++_counter >= _warmupVectors)
+        {
+          _state = kFading;
+          _counter = 0;
+        }
+        return callBranch(_current, std::forward<Fns>(branches)...);
+      }
+      case kFading:
+      {
+        auto y0 = callBranch(_current, std::forward<Fns>(branches)...);
+        auto y1 = callBranch(_next, std::forward<Fns>(branches)...);
+
+        // ramp from the end of the previous vector to the end of this one.
+        const float fadeSamples = _fadeVectors * kFloatsPerDSPVector;
+        DSPVector mix = (columnIndex() + DSPVector(_counter * kFloatsPerDSPVector + 1.f)) *
+                        DSPVector(1.f / fadeSamples);
+        if (++_counter >= _fadeVectors)
+        {
+          _current = _next;
+          _state = kSteady;
+        }
+        return lerp(y0, y1, repeatRows<ROWS>(mix));
+      }
+    }
+  }
+};
+
 // should multiplex be on multiple inputs, rows of one input, different flavors for both??
 
 // demultiplex(outputSelector, signalInput ) -> DSPVectorArray<inputs> ;
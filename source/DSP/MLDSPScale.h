@@ -17,6 +17,7 @@
 #include <locale>
 
 #include "MLDSPScalarMath.h"
+#include "MLDSPOps.h"
 
 
 namespace ml
@@ -28,6 +29,9 @@ const int kMLNumNotes = 256;
 
 const int kMLUnmappedNote = kMLNumNotes + 1;
 
+// the vector quantizers do a binary search over all the notes.
+static_assert((kMLNumNotes & (kMLNumNotes - 1)) == 0, "kMLNumNotes must be a power of two");
+
 class Scale
 {
 public:
@@ -44,7 +48,12 @@ public:
   void operator= (const Scale& b)
   {
     mScaleRatios = b.mScaleRatios;
+    mRatios = b.mRatios;
     mPitches = b.mPitches;
+    mNoteRatios = b.mNoteRatios;
+    mNoteRatioSlopes = b.mNoteRatioSlopes;
+    mFloatPitches = b.mFloatPitches;
+    mPitchFloors = b.mPitchFloors;
   }
   
   // load a scale from an input string along with an optional mapping.
@@ -209,6 +218,98 @@ public:
     }
   }
   
+  // DSPVector versions of noteToLogPitch(), quantizePitch() and
+  // quantizePitchNearest(), for pitch signals or banks of partials at audio
+  // rate. They read the float tables made in recalcRatiosAndPitches() and
+  // have no branches on the input values.
+
+  DSPVector noteToLogPitch(const DSPVector vNotes) const
+  {
+    DSPVector vy;
+    const float* px = vNotes.getConstBuffer();
+    float* py = vy.getBuffer();
+    const SIMDVectorFloat vZero = vecZeros();
+    const SIMDVectorFloat vLast = vecSet1((float)(kMLNumNotes - 1));
+
+    for (int n = 0; n < kSIMDVectorsPerDSPVector; ++n)
+    {
+      SIMDVectorFloat x = vecLoad(px);
+      SIMDVectorFloat notNaN = vecEqual(x, x);
+      SIMDVectorFloat fn = vecClamp(x, vZero, vLast);
+      SIMDVectorIntUnion idx;
+      idx.v = vecFloatToIntTruncate(fn);
+      SIMDVectorFloat frac = vecSub(fn, vecIntToFloat(idx.v));
+
+      SIMDVectorFloatUnion r0, dr;
+      for (int j = 0; j < kFloatsPerSIMDVector; ++j)
+      {
+        r0.f[j] = mNoteRatios[idx.i[j]];
+        dr.f[j] = mNoteRatioSlopes[idx.i[j]];
+      }
+      SIMDVectorFloat m = vecAdd(r0.v, vecMul(frac, dr.v));
+      vecStore(py, vecAnd(vecMul(vecLog(m), kLogTwoRVec), notNaN));
+      px += kFloatsPerSIMDVector;
+      py += kFloatsPerSIMDVector;
+    }
+    return vy;
+  }
+
+  DSPVector quantizePitch(const DSPVector vPitch) const
+  {
+    DSPVector vy;
+    const float* px = vPitch.getConstBuffer();
+    float* py = vy.getBuffer();
+    const SIMDVectorInt vZeroInt = vecSet1Int(0);
+
+    for (int n = 0; n < kSIMDVectorsPerDSPVector; ++n)
+    {
+      SIMDVectorIntUnion idx;
+      idx.v = lowerNoteIndex(vecLoad(px));
+      SIMDVectorFloatUnion lower;
+      for (int j = 0; j < kFloatsPerSIMDVector; ++j)
+      {
+        lower.f[j] = mFloatPitches[idx.i[j]];
+      }
+
+      // like the scalar version, return 0 if no note is below the input.
+      SIMDVectorInt found = vecGreaterThanInt(idx.v, vZeroInt);
+      vecStore(py, vecAnd(lower.v, VecI2F(found)));
+      px += kFloatsPerSIMDVector;
+      py += kFloatsPerSIMDVector;
+    }
+    return vy;
+  }
+
+  DSPVector quantizePitchNearest(const DSPVector vPitch) const
+  {
+    DSPVector vy;
+    const float* px = vPitch.getConstBuffer();
+    float* py = vy.getBuffer();
+    const SIMDVectorInt vZeroInt = vecSet1Int(0);
+
+    for (int n = 0; n < kSIMDVectorsPerDSPVector; ++n)
+    {
+      SIMDVectorFloat a = vecLoad(px);
+      SIMDVectorIntUnion idx;
+      idx.v = lowerNoteIndex(a);
+      SIMDVectorFloatUnion lower, higher;
+      for (int j = 0; j < kFloatsPerSIMDVector; ++j)
+      {
+        int i = idx.i[j];
+        lower.f[j] = mFloatPitches[i];
+        higher.f[j] = mFloatPitches[std::min(i + 1, kMLNumNotes - 1)];
+      }
+
+      // at the top note, higher == lower. below the first note, use note 0.
+      SIMDVectorFloat useLower = vecOr(vecLessThan(vecSub(a, lower.v), vecSub(higher.v, a)),
+                                       VecI2F(vecEqualInt(idx.v, vZeroInt)));
+      vecStore(py, vecSelect(lower.v, higher.v, useLower));
+      px += kFloatsPerSIMDVector;
+      py += kFloatsPerSIMDVector;
+    }
+    return vy;
+  }
+
   void setName(const std::string& nameStr)
   {
     mName = nameStr;
@@ -248,6 +349,27 @@ public:
 private:
   
   float noteToPitch(float note) const;
+
+  // for each lane, get the index of the highest note from 1 to kMLNumNotes - 1
+  // with a pitch <= a, or 0 if there is none. This is what the scalar
+  // quantizers search for. mPitchFloors is nondecreasing, so a binary search
+  // over it finds the same note even when some notes are unmapped.
+  inline SIMDVectorInt lowerNoteIndex(SIMDVectorFloat a) const
+  {
+    SIMDVectorIntUnion idx;
+    idx.v = vecSet1Int(0);
+    for (int step = kMLNumNotes / 2; step > 0; step >>= 1)
+    {
+      SIMDVectorFloatUnion p;
+      for (int j = 0; j < kFloatsPerSIMDVector; ++j)
+      {
+        p.f[j] = mPitchFloors[idx.i[j] + step];
+      }
+      SIMDVectorInt below = VecF2I(vecLessThanOrEqual(p.v, a));
+      idx.v = vecAddInt(idx.v, vecAndInt(below, vecSet1Int(step)));
+    }
+    return idx.v;
+  }
   
   void addRatioAsFraction(int n, int d)
   {
@@ -303,6 +425,24 @@ private:
       mRatios[i] = (r*refFreqRatio);
       mPitches[i] = std::log2(mRatios[i]);
     }
+
+    // float tables for the DSPVector methods. Each note's ratio is stored
+    // with the slope to the next one, set to 0 where the scalar version
+    // would not interpolate.
+    for (int i = 0; i < kMLNumNotes; ++i)
+    {
+      double r0 = mRatios[i];
+      double r1 = (i < kMLNumNotes - 1) ? mRatios[i + 1] : 0.;
+      mNoteRatios[i] = (r0 > 0.) ? (float)r0 : 1.f;
+      mNoteRatioSlopes[i] = ((r0 > 0.) && (r1 > 0.)) ? (float)(r1 - r0) : 0.f;
+      mFloatPitches[i] = (float)mPitches[i];
+    }
+    float lowest = mFloatPitches[kMLNumNotes - 1];
+    for (int i = kMLNumNotes - 1; i >= 0; --i)
+    {
+      lowest = std::min(lowest, mFloatPitches[i]);
+      mPitchFloors[i] = lowest;
+    }
   }
   
 
@@ -505,6 +645,14 @@ private:
   
   // pitch for each integer note number stored in linear octave space. pitch = log2(ratio).
   std::array<double, kMLNumNotes> mPitches;
+
+  // float tables for the DSPVector methods.
+  std::array<float, kMLNumNotes> mNoteRatios;
+  std::array<float, kMLNumNotes> mNoteRatioSlopes;
+  std::array<float, kMLNumNotes> mFloatPitches;
+
+  // the lowest pitch of each note and all the notes above it.
+  std::array<float, kMLNumNotes> mPitchFloors;
   
 };
 
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 
 #include "MLDSPBuffer.h"
@@ -46,9 +47,151 @@ const Projection flatTop(
     });
 }  // namespace windows
 
+// TabulatedProjection: a Projection sampled over an Interval into a table, for
+// evaluating at audio rate without calling through std::function. Input is
+// clamped to the interval. Linear or cubic (Catmull-Rom) interpolation is done
+// four samples at a time on DSPVectors. getMaxError() returns the largest
+// difference from the original projection, measured on a grid four times
+// denser than the table.
+
+class TabulatedProjection
+{
+ public:
+  enum Interpolation
+  {
+    kLinear = 0,
+    kCubic = 1
+  };
+
+  TabulatedProjection() : TabulatedProjection(projections::unity, {0.f, 1.f}, 2) {}
+  TabulatedProjection(Projection p, Interval domain, size_t tableSize = 256,
+                      Interpolation interp = kLinear)
+      : _domain(domain), _interp(interp)
+  {
+    const size_t n = std::max(tableSize, size_t(2));
+    _lastIndex = static_cast<int>(n - 1);
+    const float width = domain.mX2 - domain.mX1;
+    _scale = (width != 0.f) ? _lastIndex / width : 0.f;
+    _offset = -domain.mX1 * _scale;
+
+    // table has one guard point before and two after, extrapolated linearly.
+    auto indexToX = projections::linear({0.f, n - 1.f}, domain);
+    _table.resize(n + 3);
+    float* pTable = _table.data() + 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+      pTable[i] = p(indexToX((float)i));
+    }
+    pTable[-1] = 2.f * pTable[0] - pTable[1];
+    pTable[n] = 2.f * pTable[n - 1] - pTable[n - 2];
+    pTable[n + 1] = pTable[n];
+
+    _maxError = 0.f;
+    constexpr int kOversample = 4;
+    auto fineToX = projections::linear({0.f, (n - 1.f) * kOversample}, domain);
+    for (size_t i = 0; i <= (n - 1) * kOversample; ++i)
+    {
+      float x = fineToX((float)i);
+      _maxError = std::max(_maxError, fabsf(p(x) - operator()(x)));
+    }
+  }
+
+  float getMaxError() const { return _maxError; }
+  Interval getDomain() const { return _domain; }
+
+  inline float operator()(float x) const
+  {
+    const float* pTable = _table.data() + 1;
+    float u = ml::clamp(x * _scale + _offset, 0.f, (float)_lastIndex);
+    int i = std::min(static_cast<int>(u), _lastIndex - 1);
+    float f = u - i;
+    if (_interp == kLinear)
+    {
+      return lerp(pTable[i], pTable[i + 1], f);
+    }
+    else
+    {
+      return cubic(pTable[i - 1], pTable[i], pTable[i + 1], pTable[i + 2], f);
+    }
+  }
+
+  inline DSPVector operator()(const DSPVector vx) const
+  {
+    DSPVector vy;
+    const float* pTable = _table.data() + 1;
+    const float* px = vx.getConstBuffer();
+    float* py = vy.getBuffer();
+    const SIMDVectorFloat vScale = vecSet1(_scale);
+    const SIMDVectorFloat vOffset = vecSet1(_offset);
+    const SIMDVectorFloat vZero = vecZeros();
+    const SIMDVectorFloat vLast = vecSet1((float)_lastIndex);
+    const SIMDVectorFloat vLastStart = vecSet1((float)(_lastIndex - 1));
+
+    for (int n = 0; n < kSIMDVectorsPerDSPVector; ++n)
+    {
+      SIMDVectorFloat u = vecClamp(vecAdd(vecMul(vecLoad(px), vScale), vOffset), vZero, vLast);
+      SIMDVectorFloat vi = vecIntToFloat(vecFloatToIntTruncate(vecMin(u, vLastStart)));
+      SIMDVectorFloat f = vecSub(u, vi);
+      SIMDVectorIntUnion idx;
+      idx.v = vecFloatToIntTruncate(vi);
+
+      // gather the table points around each sample.
+      SIMDVectorFloatUnion y0, y1, y2, y3;
+      for (int j = 0; j < kFloatsPerSIMDVector; ++j)
+      {
+        const float* pt = pTable + idx.i[j];
+        y0.f[j] = pt[-1];
+        y1.f[j] = pt[0];
+        y2.f[j] = pt[1];
+        y3.f[j] = pt[2];
+      }
+
+      SIMDVectorFloat y;
+      if (_interp == kLinear)
+      {
+        y = vecAdd(y1.v, vecMul(f, vecSub(y2.v, y1.v)));
+      }
+      else
+      {
+        // Catmull-Rom spline in Horner form
+        const SIMDVectorFloat half = vecSet1(0.5f);
+        SIMDVectorFloat c1 = vecMul(half, vecSub(y2.v, y0.v));
+        SIMDVectorFloat c2 = vecAdd(vecSub(y0.v, vecMul(vecSet1(2.5f), y1.v)),
+                                    vecSub(vecMul(vecSet1(2.f), y2.v), vecMul(half, y3.v)));
+        SIMDVectorFloat c3 = vecAdd(vecMul(half, vecSub(y3.v, y0.v)),
+                                    vecMul(vecSet1(1.5f), vecSub(y1.v, y2.v)));
+        y = vecAdd(vecMul(vecAdd(vecMul(vecAdd(vecMul(c3, f), c2), f), c1), f), y1.v);
+      }
+      vecStore(py, y);
+      px += kFloatsPerSIMDVector;
+      py += kFloatsPerSIMDVector;
+    }
+    return vy;
+  }
+
+ private:
+  static inline float cubic(float y0, float y1, float y2, float y3, float f)
+  {
+    float c1 = 0.5f * (y2 - y0);
+    float c2 = y0 - 2.5f * y1 + 2.f * y2 - 0.5f * y3;
+    float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+    return ((c3 * f + c2) * f + c1) * f + y1;
+  }
+
+  std::vector<float> _table;
+  Interval _domain{0.f, 1.f};
+  Interpolation _interp{kLinear};
+  float _scale{0.f};
+  float _offset{0.f};
+  float _maxError{0.f};
+  int _lastIndex{1};
+};
+
 // VectorProcessBuffer: utility class to serve a main loop with varying
 // arbitrary chunk sizes, buffer inputs and outputs, and compute DSP in
-// DSPVector-sized chunks.
+// DSPVector-sized chunks. When nothing is buffered and the host asks for a
+// whole number of DSPVectors, the buffers are skipped and vectors are loaded
+// from and stored to the host's memory directly.
 
 using MainInputs = const DSPVectorDynamic&;
 using MainOutputs = DSPVectorDynamic&;
@@ -90,6 +233,12 @@ class VectorProcessBuffer
     if(!outputs) return;
     if (nFrames > (int)_maxFrames) return;
 
+    if ((nFrames % kFloatsPerDSPVector == 0) && buffersAreEmpty())
+    {
+      processDirect(inputs, outputs, nFrames, processFn, stateData);
+      return;
+    }
+
     // write vectors from inputs (if any) to inputBuffers
     for(int c = 0; c < nInputs; c++)
     {
@@ -124,6 +273,66 @@ class VectorProcessBuffer
       }
     }
   }
+
+ private:
+  static bool isSIMDAligned(const float* p)
+  {
+    return (reinterpret_cast<uintptr_t>(p) % (kFloatsPerSIMDVector * sizeof(float))) == 0;
+  }
+
+  // the output buffers are always all at the same position, so checking one is enough.
+  bool buffersAreEmpty() const
+  {
+    for (auto& b : _inputBuffers)
+    {
+      if (b.getReadAvailable() > 0) return false;
+    }
+    return _outputBuffers[0].getReadAvailable() == 0;
+  }
+
+  // process nFrames, a multiple of the vector size, with no buffering.
+  void processDirect(const float** inputs, float** outputs, int nFrames, ProcessVectorFn& processFn,
+                     void* stateData)
+  {
+    size_t nInputs = _inputVectors.size();
+    size_t nOutputs = _outputVectors.size();
+
+    for (int offset = 0; offset < nFrames; offset += kFloatsPerDSPVector)
+    {
+      for (size_t c = 0; c < nInputs; c++)
+      {
+        const float* pSrc = inputs ? inputs[c] : nullptr;
+        if (!pSrc)
+        {
+          _inputVectors[c] = DSPVector{};
+        }
+        else if (isSIMDAligned(pSrc))
+        {
+          loadAligned(_inputVectors[c], pSrc + offset);
+        }
+        else
+        {
+          load(_inputVectors[c], pSrc + offset);
+        }
+      }
+
+      processFn(_inputVectors, _outputVectors, stateData);
+
+      for (size_t c = 0; c < nOutputs; c++)
+      {
+        float* pDest = outputs[c];
+        if (!pDest) continue;
+        if (isSIMDAligned(pDest))
+        {
+          storeAligned(_outputVectors[c], pDest + offset);
+        }
+        else
+        {
+          store(_outputVectors[c], pDest + offset);
+        }
+      }
+    }
+  }
 };
 
 // FlushToZeroHandler: turn off denormal math so that (for example) IIR filters don't consume
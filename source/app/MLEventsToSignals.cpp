@@ -33,6 +33,7 @@ void EventsToSignals::Voice::reset(int i)
   nextFrameToProcess = 0;
   ageInSamples = 0;
   ageStep = 0;
+  silentVectors = 0;
 
   currentVelocity = 0;
   currentPitch = 0;
@@ -67,12 +68,25 @@ void EventsToSignals::Voice::beginProcess(float sr)
   }
 }
 
-float getAgeInSeconds(uint32_t age, float sr)
+void EventsToSignals::Voice::writeSegment(size_t start, size_t end, float sampleRate)
 {
-  double dAge(age);
-  double dSr(sr);
-  double dSeconds = dAge / dSr;
-  return (float)dSeconds;
+  if(end <= start) return;
+  const size_t n = end - start;
+  
+  float* pGate = outputs.row(kGate).getBuffer() + start;
+  std::fill(pGate, pGate + n, currentVelocity);
+  pitchGlide.writeSamples(currentPitch, outputs.row(kPitch).getBuffer() + start, n);
+
+  // age increases before each sample is written. The start time is in double
+  // precision so that long notes stay accurate.
+  const float startSeconds = (float)((double)ageInSamples / sampleRate);
+  const float secondsPerSample = (float)((double)ageStep / sampleRate);
+  float* pAge = outputs.row(kElapsedTime).getBuffer() + start;
+  for(size_t i = 0; i < n; ++i)
+  {
+    pAge[i] = startSeconds + secondsPerSample*(i + 1);
+  }
+  ageInSamples += ageStep*(uint32_t)n;
 }
 
 void EventsToSignals::Voice::writeNoteEvent(const Event& e, const Scale& scale, float sampleRate)
@@ -92,13 +106,7 @@ void EventsToSignals::Voice::writeNoteEvent(const Event& e, const Scale& scale,
       destTime = clamp(destTime, (0), (int)kFloatsPerDSPVector);
       
       // write current pitch and velocity up to note start
-      for(int t = (int)nextFrameToProcess; t < destTime; ++t)
-      {
-        outputs.row(kGate)[t] = currentVelocity;
-        outputs.row(kPitch)[t] = pitchGlide.nextSample(currentPitch);
-        ageInSamples += ageStep;
-        outputs.row(kElapsedTime)[t] = getAgeInSeconds(ageInSamples, sampleRate);
-      }
+      writeSegment(nextFrameToProcess, destTime, sampleRate);
       
       // set new values
       currentPitch = scale.noteToLogPitch(e.value1);
@@ -121,13 +129,7 @@ void EventsToSignals::Voice::writeNoteEvent(const Event& e, const Scale& scale,
       }
       
       // write current pitch and velocity up to retrigger
-      for(int t = (int)nextFrameToProcess; t < destTime - 1; ++t)
-      {
-        outputs.row(kGate)[t] = currentVelocity;
-        outputs.row(kPitch)[t] = pitchGlide.nextSample(currentPitch);
-        ageInSamples += ageStep;
-        outputs.row(kElapsedTime)[t] = getAgeInSeconds(ageInSamples, sampleRate);
-      }
+      writeSegment(nextFrameToProcess, destTime - 1, sampleRate);
       
       // write retrigger frame
       outputs.row(kGate)[destTime - 1] = 0;
@@ -154,14 +156,8 @@ void EventsToSignals::Voice::writeNoteEvent(const Event& e, const Scale& scale,
       size_t destTime = e.time;
       destTime = clamp(destTime, size_t(0), (size_t)kFloatsPerDSPVector);
       
-      // write current values up to change TODO DRY
-      for(int t = (int)nextFrameToProcess; t < destTime; ++t)
-      {
-        outputs.row(kGate)[t] = currentVelocity;
-        outputs.row(kPitch)[t] = pitchGlide.nextSample(currentPitch);
-        ageInSamples += ageStep;
-        outputs.row(kElapsedTime)[t] = getAgeInSeconds(ageInSamples, sampleRate);
-      }
+      // write current values up to change
+      writeSegment(nextFrameToProcess, destTime, sampleRate);
       
       // set new values
       currentVelocity = 0.;
@@ -176,18 +172,8 @@ void EventsToSignals::Voice::writeNoteEvent(const Event& e, const Scale& scale,
 
 void EventsToSignals::Voice::endProcess(float pitchBend, float sampleRate)
 {
-  for(int t = (int)nextFrameToProcess; t < kFloatsPerDSPVector; ++t)
-  {
-    // write velocity to end of buffer.
-    outputs.row(kGate)[t] = currentVelocity;
-    
-    // write pitch to end of buffer.
-    outputs.row(kPitch)[t] = pitchGlide.nextSample(currentPitch);
-    
-    // keep increasing age
-    ageInSamples += ageStep;
-    outputs.row(kElapsedTime)[t] = getAgeInSeconds(ageInSamples, sampleRate);
-  }
+  // write velocity, pitch and age to end of buffer.
+  writeSegment(nextFrameToProcess, kFloatsPerDSPVector, sampleRate);
   
   // process glides, accurate to the DSP vector
   auto bendGlide = pitchBendGlide(currentPitchBend);
@@ -202,6 +188,22 @@ void EventsToSignals::Voice::endProcess(float pitchBend, float sampleRate)
   
   // add drift to pitch output
   outputs.row(kPitch) += driftSig*driftAmount*kDriftScale;
+  
+  // count vectors of silence for clients that want to skip idle voices
+  if((state == kOff) && isZero(outputs.row(kGate)))
+  {
+    if(silentVectors < std::numeric_limits<uint32_t>::max()) silentVectors++;
+  }
+  else
+  {
+    silentVectors = 0;
+  }
+}
+
+bool EventsToSignals::Voice::isIdle(float tailTimeInSeconds, float sr) const
+{
+  float tailVectors = ceilf(tailTimeInSeconds*sr/kFloatsPerDSPVector);
+  return silentVectors > tailVectors;
 }
 
 #pragma mark -
@@ -211,9 +213,13 @@ void EventsToSignals::Voice::endProcess(float pitchBend, float sampleRate)
 
 EventsToSignals::EventsToSignals(int sr) : _eventQueue(kMaxEventsPerVector)
 {
+  _eventBuffer.resize(kMaxEventsPerVector);
+  _sortedEvents.resize(kMaxEventsPerVector);
   _sampleRate = (float)sr;
   
   voices.resize(kMaxVoices);
+  _freeVoices.resize(kMaxVoices);
+  _voiceIsFree.resize(kMaxVoices);
   
   for(int i=0; i<kMaxVoices; ++i)
   {
@@ -230,7 +236,8 @@ EventsToSignals::~EventsToSignals()
 size_t EventsToSignals::setPolyphony(int n)
 {
   reset();
-  _polyphony = std::min(n, kMaxVoices);
+  _polyphony = clamp(n, 0, kMaxVoices);
+  buildFreeList();
   return _polyphony;
 }
 
@@ -249,7 +256,7 @@ void EventsToSignals::reset()
     v.reset(i++);
   }
   
-  _lastFreeVoiceFound = -1;
+  buildFreeList();
 }
 
 void EventsToSignals::addEvent(const Event& e)
@@ -257,19 +264,113 @@ void EventsToSignals::addEvent(const Event& e)
   _eventQueue.push(e);
 }
 
+size_t EventsToSignals::addEvents(const Event* pEvents, size_t n)
+{
+  size_t i = 0;
+  while((i < n) && _eventQueue.push(pEvents[i]))
+  {
+    i++;
+  }
+  return i;
+}
+
 void EventsToSignals::process()
 {
-  for(auto& v : voices)
+  for(int v = 0; v < _polyphony; ++v)
   {
-    v.beginProcess(_sampleRate);
+    voices[v].beginProcess(_sampleRate);
   }
-  while(Event e = _eventQueue.pop())
+  
+  // get all the events for this vector in time order, so that each voice can
+  // write its signals in one pass.
+  size_t nEvents = 0;
+  while((nEvents < _eventBuffer.size()) && _eventQueue.pop(_eventBuffer[nEvents]))
   {
-    processEvent(e);
+    nEvents++;
   }
-  for(auto& v : voices)
+  sortEvents(nEvents);
+  coalesceEvents(nEvents);
+  
+  for(size_t i = 0; i < nEvents; ++i)
+  {
+    processEvent(_eventBuffer[i]);
+  }
+  for(int v = 0; v < _polyphony; ++v)
+  {
+    voices[v].endProcess(kPitchBendSemitones, _sampleRate);
+  }
+}
+
+// counting sort by time: stable, O(n) however the events are interleaved,
+// and doesn't allocate. Event times are within one vector, so there are only
+// kFloatsPerDSPVector keys.
+void EventsToSignals::sortEvents(size_t nEvents)
+{
+  auto timeKey = [](const Event& e)
+  {
+    return static_cast<size_t>(ml::clamp(e.time, 0, static_cast<int>(kFloatsPerDSPVector) - 1));
+  };
+
+  // count the events at each time, then make the counts into start positions.
+  std::array<size_t, kFloatsPerDSPVector + 1> starts{};
+  for(size_t i = 0; i < nEvents; ++i)
+  {
+    starts[timeKey(_eventBuffer[i]) + 1]++;
+  }
+  for(size_t t = 1; t < starts.size(); ++t)
   {
-    v.endProcess(kPitchBendSemitones, _sampleRate);
+    starts[t] += starts[t - 1];
+  }
+
+  for(size_t i = 0; i < nEvents; ++i)
+  {
+    _sortedEvents[starts[timeKey(_eventBuffer[i])]++] = _eventBuffer[i];
+  }
+  std::swap(_eventBuffer, _sortedEvents);
+}
+
+// controller, pitch wheel and pressure events only set values that are read at
+// the end of the vector. So only the last event of each kind matters, and the
+// others are cleared to kNull.
+void EventsToSignals::coalesceEvents(size_t nEvents)
+{
+  constexpr int kPitchWheelKey{128};
+  constexpr int kPressureKey{129};
+  constexpr int kNumKeys{130};
+  
+  auto getKey = [](const Event& e)
+  {
+    switch(e.type)
+    {
+      case kPitchWheel:
+        return kPitchWheelKey;
+      case kNotePressure:
+        return kPressureKey;
+      case kController:
+      {
+        // all sound off and all notes off are actions, not values
+        int ctrl = (int)e.value2;
+        bool isValue = (ctrl >= 0) && (ctrl < 128) && (ctrl != 120) && (ctrl != 123);
+        return isValue ? ctrl : -1;
+      }
+      default:
+        return -1;
+    }
+  };
+  
+  std::array<bool, kNumKeys> seen{};
+  for(size_t i = nEvents; i > 0; --i)
+  {
+    Event& e = _eventBuffer[i - 1];
+    int key = getKey(e);
+    if(key >= 0)
+    {
+      if(seen[key])
+      {
+        e.type = kNull;
+      }
+      seen[key] = true;
+    }
   }
 }
 
@@ -310,7 +411,7 @@ void EventsToSignals::processNoteOnEvent(const Event& e)
 
   if(v >= 0)
   {
-    voices[v].writeNoteEvent(e, _scale, _sampleRate);
+    writeVoiceEvent(v, e);
   }
   else
   {
@@ -321,7 +422,7 @@ void EventsToSignals::processNoteOnEvent(const Event& e)
     // are cut off. add more graceful stealing
     Event f = e;
     f.type = kNoteRetrig;
-    voices[v].writeNoteEvent(f, _scale, _sampleRate);
+    writeVoiceEvent(v, f);
   }
   newestVoice = v;
 }
@@ -338,7 +439,7 @@ void EventsToSignals::processNoteOffEvent(const Event& e)
     {
       Event eventToSend = e;
       eventToSend.type = newEventType;
-      voice.writeNoteEvent(eventToSend, _scale, _sampleRate);
+      writeVoiceEvent(v, eventToSend);
     }
   }
 }
@@ -386,7 +487,7 @@ void EventsToSignals::processControllerEvent(const Event& event)
         {
           Event eventToSend = event;
           eventToSend.type = kNoteOff;
-          voice.writeNoteEvent(eventToSend, _scale, _sampleRate);
+          writeVoiceEvent(v, eventToSend);
         }
       }
     }
@@ -425,7 +526,7 @@ void EventsToSignals::processSustainEvent(const Event& event)
       {
         Event newEvent;
         newEvent.type = kNoteOff;
-        v.writeNoteEvent(newEvent, _scale, _sampleRate);
+        writeVoiceEvent(i, newEvent);
       }
     }
   }
@@ -457,27 +558,43 @@ void EventsToSignals::setDriftAmount(float f)
 #pragma mark -
 
 // return index of free voice or -1 for none.
-// increments mVoiceRotateOffset.
+// voices are taken from the free list in the order they were released.
 //
 int EventsToSignals::findFreeVoice()
 {
-  int len = _polyphony;
-  int r = -1;
-  int t = _lastFreeVoiceFound;
-  for (int i = 0; i < len; ++i)
+  if(!_freeCount) return -1;
+  int r = _freeVoices[_freeHead];
+  _freeHead = (_freeHead + 1) % kMaxVoices;
+  _freeCount--;
+  _voiceIsFree[r] = false;
+  return r;
+}
+
+void EventsToSignals::writeVoiceEvent(int v, const Event& e)
+{
+  Voice& voice = voices[v];
+  voice.writeNoteEvent(e, _scale, _sampleRate);
+  if((voice.state == Voice::kOff) && !_voiceIsFree[v])
   {
-    t++;
-    if(t >= len) t = 0;
-    
-    if (voices[t].state == Voice::kOff)
+    _freeVoices[(_freeHead + _freeCount) % kMaxVoices] = v;
+    _freeCount++;
+    _voiceIsFree[v] = true;
+  }
+}
+
+void EventsToSignals::buildFreeList()
+{
+  _freeHead = 0;
+  _freeCount = 0;
+  std::fill(_voiceIsFree.begin(), _voiceIsFree.end(), false);
+  for(int v = 0; v < _polyphony; ++v)
+  {
+    if(voices[v].state == Voice::kOff)
     {
-      r = t;
-      _lastFreeVoiceFound = t;
-      break;
+      _freeVoices[_freeCount++] = v;
+      _voiceIsFree[v] = true;
     }
   }
-
-  return r;
 }
 
 int EventsToSignals::findVoiceToSteal(Event e)
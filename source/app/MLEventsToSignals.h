@@ -48,8 +48,8 @@ class EventsToSignals final
 {
 public:
 
-  static constexpr int kMaxVoices{16};
-  static constexpr int kMaxEventsPerVector{128};
+  static constexpr int kMaxVoices{128};
+  static constexpr int kMaxEventsPerVector{1024};
   
   static constexpr float kGlideTimeSeconds{0.02f};
   static constexpr float kDriftTimeSeconds{8.0f};
@@ -107,6 +107,14 @@ public:
     // add pitchBend to pitch.
     void endProcess(float pitchBend, float sr);
     
+    // write the current gate, pitch and age from frame start up to end.
+    void writeSegment(size_t start, size_t end, float sr);
+    
+    // returns true if the voice has been off, with its gate output at zero, for at
+    // least the given time. Clients can pass the release time of their own envelopes
+    // here in order to skip processing a voice's entire graph once its tail is over.
+    bool isIdle(float tailTimeInSeconds, float sr) const;
+    
     int state{kOff};
     size_t nextFrameToProcess{0};
 
@@ -122,6 +130,9 @@ public:
     int creatorID{0}; // for matching event sources, could be MIDI key, or touch number.
     uint32_t ageInSamples{0};
     uint32_t ageStep{0};
+    
+    // number of whole vectors for which the gate output has been zero.
+    uint32_t silentVectors{0};
 
     SampleAccurateLinearGlide pitchGlide;
     LinearGlide pitchBendGlide;
@@ -161,6 +172,10 @@ public:
   // add an event to the queue.
   void addEvent(const Event& e);
   
+  // add a number of events to the queue at once. Returns the number of events
+  // added, which is less than n if the queue is full.
+  size_t addEvents(const Event* pEvents, size_t n);
+  
   // process all events in queue and generate output signals.
   void process();
   
@@ -174,6 +189,10 @@ public:
 private:
   
   void processEvent(const Event &eventParam);
+  
+  // sort the events for one vector by time, and remove redundant updates.
+  void sortEvents(size_t nEvents);
+  void coalesceEvents(size_t nEvents);
   void processNoteOnEvent(const Event& event);
   void processNoteOffEvent(const Event& event);
   void processNoteUpdateEvent(const Event& event);
@@ -186,6 +205,11 @@ private:
   // find a free voice index. if no free voice is found return -1.
   int findFreeVoice();
   
+  // write an event to a voice, and add the voice to the free list if the
+  // event turned it off.
+  void writeVoiceEvent(int v, const Event& e);
+  void buildFreeList();
+  
   int findVoiceToSteal(Event e);
   int findNearestVoice(int note);
   
@@ -194,8 +218,19 @@ private:
   // data
   Scale _scale;
   Queue< Event > _eventQueue;
+  std::vector< Event > _eventBuffer;
+
+  // sortEvents() writes here, then swaps with _eventBuffer.
+  std::vector< Event > _sortedEvents;
   int _polyphony{0};
-  int _lastFreeVoiceFound{-1};
+  
+  // free voices in the order they were turned off, so the voice that has been
+  // released the longest is reused first.
+  std::vector<int> _freeVoices;
+  std::vector<bool> _voiceIsFree;
+  size_t _freeHead{0};
+  size_t _freeCount{0};
+  
   int newestVoice{-1};
   bool _sustainPedalActive{false};
   float _sampleRate;
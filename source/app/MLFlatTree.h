@@ -0,0 +1,565 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020-2022 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "MLPath.h"
+#include "MLValue.h"
+
+// FlatTree: a map from Paths to values with the same interface as Tree for
+// adding, looking up, erasing and iterating, but with flat storage. Nodes are
+// allocated from a pool in fixed-size chunks and refer to each other by index.
+// The children of every node are found through one open-addressed hash table
+// keyed by parent and Symbol, and linked in sorted order for iteration.
+// Iterators are just a few indices and never allocate.
+//
+// Unlike Tree, getNode() returns a pointer to a FlatTree::Node and not to a
+// subtree. Node pointers stay valid until the node is erased or the tree is
+// cleared.
+
+namespace ml
+{
+template <class V, class C = std::less<Symbol> >
+class FlatTree
+{
+ public:
+  using NodeIndex = uint32_t;
+  static constexpr NodeIndex kNoNode{0xFFFFFFFF};
+  static constexpr NodeIndex kRootNode{0};
+
+  class Node
+  {
+    friend class FlatTree<V, C>;
+    V _value{};
+    Symbol _name{};
+    NodeIndex _parent{kNoNode};
+    NodeIndex _firstChild{kNoNode};
+    NodeIndex _nextSibling{kNoNode};
+
+   public:
+    bool hasValue() const { return _value != V(); }
+    const V& getValue() const { return _value; }
+    V& getValue() { return _value; }
+    bool isLeaf() const { return _firstChild == kNoNode; }
+    Symbol getName() const { return _name; }
+  };
+
+ private:
+  static constexpr int kChunkBits{6};
+  static constexpr NodeIndex kChunkSize{1 << kChunkBits};
+  static constexpr NodeIndex kChunkMask{kChunkSize - 1};
+  static constexpr size_t kMinChildIndexSize{16};
+
+  // one entry in the index of children. An empty slot has node == kNoNode.
+  struct ChildSlot
+  {
+    NodeIndex parent{kNoNode};
+    NodeIndex node{kNoNode};
+    SymbolID key{0};
+  };
+
+  std::vector<std::unique_ptr<Node[]> > _chunks;
+  std::vector<NodeIndex> _freeNodes;
+  NodeIndex _nodesUsed{0};
+
+  std::vector<ChildSlot> _childIndex;
+  size_t _childCount{0};
+
+  inline Node& node(NodeIndex i) { return _chunks[i >> kChunkBits][i & kChunkMask]; }
+  inline const Node& node(NodeIndex i) const { return _chunks[i >> kChunkBits][i & kChunkMask]; }
+
+  static inline size_t childHash(NodeIndex parent, SymbolID key)
+  {
+    uint64_t h = (parent * 0x9E3779B97F4A7C15ull) ^ (key * 0xC2B2AE3D27D4EB4Full);
+    return static_cast<size_t>(h ^ (h >> 29));
+  }
+
+  // find the slot of the given child, or the empty slot where it would go.
+  inline size_t findSlot(NodeIndex parent, SymbolID key) const
+  {
+    const size_t mask = _childIndex.size() - 1;
+    size_t i = childHash(parent, key) & mask;
+    while (_childIndex[i].node != kNoNode)
+    {
+      if ((_childIndex[i].parent == parent) && (_childIndex[i].key == key)) break;
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  inline NodeIndex findChild(NodeIndex parent, Symbol key) const
+  {
+    return _childIndex[findSlot(parent, key.getID())].node;
+  }
+
+  void growChildIndex()
+  {
+    std::vector<ChildSlot> oldIndex(_childIndex.size() * 2);
+    std::swap(oldIndex, _childIndex);
+    for (auto& slot : oldIndex)
+    {
+      if (slot.node != kNoNode)
+      {
+        _childIndex[findSlot(slot.parent, slot.key)] = slot;
+      }
+    }
+  }
+
+  // remove a child from the index, shifting back any entries after it that
+  // would otherwise no longer be found.
+  void removeFromChildIndex(NodeIndex parent, SymbolID key)
+  {
+    const size_t mask = _childIndex.size() - 1;
+    size_t i = findSlot(parent, key);
+    if (_childIndex[i].node == kNoNode) return;
+    size_t j = i;
+    while (true)
+    {
+      j = (j + 1) & mask;
+      if (_childIndex[j].node == kNoNode) break;
+      size_t home = childHash(_childIndex[j].parent, _childIndex[j].key) & mask;
+
+      // move entry j back to i unless its home is cyclically in (i, j].
+      bool homeInRange = (i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j));
+      if (!homeInRange)
+      {
+        _childIndex[i] = _childIndex[j];
+        i = j;
+      }
+    }
+    _childIndex[i] = ChildSlot();
+    _childCount--;
+  }
+
+  NodeIndex allocateNode()
+  {
+    if (!_freeNodes.empty())
+    {
+      NodeIndex i = _freeNodes.back();
+      _freeNodes.pop_back();
+      return i;
+    }
+    if (_nodesUsed == _chunks.size() * kChunkSize)
+    {
+      _chunks.emplace_back(new Node[kChunkSize]);
+    }
+    return _nodesUsed++;
+  }
+
+  void freeNode(NodeIndex i)
+  {
+    node(i) = Node();
+    _freeNodes.push_back(i);
+  }
+
+  // add a new child to the parent, keeping the children sorted by C.
+  NodeIndex addChild(NodeIndex parent, Symbol key)
+  {
+    if ((_childCount + 1) * 2 > _childIndex.size())
+    {
+      growChildIndex();
+    }
+
+    NodeIndex newNode = allocateNode();
+    Node& n = node(newNode);
+    n._name = key;
+    n._parent = parent;
+
+    NodeIndex prev = kNoNode;
+    NodeIndex next = node(parent)._firstChild;
+    while ((next != kNoNode) && C()(node(next)._name, key))
+    {
+      prev = next;
+      next = node(next)._nextSibling;
+    }
+    n._nextSibling = next;
+    if (prev == kNoNode)
+    {
+      node(parent)._firstChild = newNode;
+    }
+    else
+    {
+      node(prev)._nextSibling = newNode;
+    }
+
+    _childIndex[findSlot(parent, key.getID())] = ChildSlot{parent, newNode, key.getID()};
+    _childCount++;
+    return newNode;
+  }
+
+  NodeIndex findNode(Path path) const
+  {
+    NodeIndex n = kRootNode;
+    for (Symbol key : path)
+    {
+      n = findChild(n, key);
+      if (n == kNoNode) break;
+    }
+    return n;
+  }
+
+ public:
+  FlatTree() { clear(); }
+  FlatTree(V val)
+  {
+    clear();
+    node(kRootNode)._value = std::move(val);
+  }
+
+  FlatTree(const FlatTree& b)
+      : _freeNodes(b._freeNodes),
+        _nodesUsed(b._nodesUsed),
+        _childIndex(b._childIndex),
+        _childCount(b._childCount)
+  {
+    for (auto& chunk : b._chunks)
+    {
+      _chunks.emplace_back(new Node[kChunkSize]);
+      std::copy(chunk.get(), chunk.get() + kChunkSize, _chunks.back().get());
+    }
+  }
+
+  FlatTree& operator=(const FlatTree& b)
+  {
+    if (this != &b)
+    {
+      *this = FlatTree(b);
+    }
+    return *this;
+  }
+
+  FlatTree(FlatTree&& b) = default;
+  FlatTree& operator=(FlatTree&& b) = default;
+
+  void clear()
+  {
+    _chunks.clear();
+    _freeNodes.clear();
+    _nodesUsed = 0;
+    _childIndex.assign(kMinChildIndexSize, ChildSlot());
+    _childCount = 0;
+    allocateNode();
+  }
+
+  void combine(const FlatTree& b)
+  {
+    for (auto it = b.begin(); it != b.end(); ++it)
+    {
+      add(it.getCurrentPath(), *it);
+    }
+  }
+
+  bool hasValue() const { return node(kRootNode).hasValue(); }
+  const V& getValue() const { return node(kRootNode)._value; }
+  bool isLeaf() const { return node(kRootNode).isLeaf(); }
+
+  // find a tree node at the specified path.
+  // if successful, return a const pointer to the node. If unsuccessful, return nullptr.
+  const Node* getConstNode(Path path) const
+  {
+    NodeIndex n = findNode(path);
+    return (n != kNoNode) ? &node(n) : nullptr;
+  }
+
+  // find a tree node at the specified path.
+  // if successful, return a pointer to the node. If unsuccessful, return nullptr.
+  Node* getNode(Path path) const { return const_cast<Node*>(getConstNode(path)); }
+
+  // if the path exists, returns a reference to the value in the tree at the
+  // path. else, add a new default object of our value type V.
+  V& operator[](Path p)
+  {
+    NodeIndex n = findNode(p);
+    return (n != kNoNode) ? node(n)._value : add(p, V())->_value;
+  }
+
+  // if the path exists, returns a const reference to the value in the tree at
+  // the path. Otherwise, reference to a null valued object is returned.
+  const V& operator[](Path p) const
+  {
+    static V nullValue{};
+    NodeIndex n = findNode(p);
+    return (n != kNoNode) ? node(n)._value : nullValue;
+  }
+
+  // compare two FlatTrees by value.
+  inline bool operator==(const FlatTree& b) const
+  {
+    auto itA = begin();
+    auto itB = b.begin();
+    for (; (itA != end()) && (itB != b.end()); ++itA, ++itB)
+    {
+      if (itA.getCurrentNodeName() != itB.getCurrentNodeName()) return false;
+      if (*itA != *itB) return false;
+    }
+    return (itA == end()) && (itB == b.end());
+  }
+
+  inline bool operator!=(const FlatTree& b) const { return !(operator==(b)); }
+
+  // write a value V to the tree such that getValue(path) will return V.
+  // add any intermediate nodes necessary in order to put it there.
+  // a pointer to the existing or new tree node is returned.
+  Node* add(Path path, V val)
+  {
+    NodeIndex n = kRootNode;
+    for (Symbol key : path)
+    {
+      NodeIndex child = findChild(n, key);
+      n = (child != kNoNode) ? child : addChild(n, key);
+    }
+    node(n)._value = std::move(val);
+    return &node(n);
+  }
+
+  // remove the node at the path, and all of its children. Erasing the empty
+  // path clears the tree.
+  void erase(Path p)
+  {
+    if (!p)
+    {
+      clear();
+      return;
+    }
+    NodeIndex n = findNode(p);
+    if (n == kNoNode) return;
+
+    // unlink the node from its parent.
+    NodeIndex parent = node(n)._parent;
+    NodeIndex* pLink = &node(parent)._firstChild;
+    while (*pLink != n)
+    {
+      pLink = &node(*pLink)._nextSibling;
+    }
+    *pLink = node(n)._nextSibling;
+    removeFromChildIndex(parent, node(n)._name.getID());
+
+    // free the subtree from the bottom up without recursion: go down through
+    // first children to a leaf, free it, and go back up to its parent.
+    NodeIndex current = n;
+    while (true)
+    {
+      Node& c = node(current);
+      if (c._firstChild != kNoNode)
+      {
+        current = c._firstChild;
+        continue;
+      }
+      if (current == n)
+      {
+        freeNode(current);
+        break;
+      }
+      NodeIndex up = c._parent;
+      node(up)._firstChild = c._nextSibling;
+      removeFromChildIndex(up, c._name.getID());
+      freeNode(current);
+      current = up;
+    }
+  }
+
+  // NOTE as with Tree, this iterator only supports simple begin(), end()
+  // loops and range-based for. Use the pre-increment form ++it.
+
+  class const_iterator
+  {
+    friend class FlatTree<V, C>;
+    const FlatTree<V, C>* _tree{nullptr};
+
+    // the parent of the current node, and the current node, which is kNoNode
+    // at the end of the parent's children.
+    NodeIndex _parent{kNoNode};
+    NodeIndex _node{kNoNode};
+    int _depth{0};
+
+    const_iterator(const FlatTree<V, C>* t, NodeIndex node) : _tree(t), _parent(kRootNode), _node(node) {}
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = const V;
+    using difference_type = int;
+    using pointer = const V*;
+    using reference = const V&;
+
+    // null iterator that can be returned so begin() = end() when there is no container
+    const_iterator() = default;
+
+    bool operator==(const const_iterator& b) const
+    {
+      return (_tree == b._tree) && (_parent == b._parent) && (_node == b._node);
+    }
+
+    bool operator!=(const const_iterator& b) const { return !(*this == b); }
+
+    const V& operator*() const { return _tree->node(_node)._value; }
+
+    // return true if at the end of the current node's siblings.
+    bool atEndOfMap() const { return _node == kNoNode; }
+
+    // advance to the next node depth-first. Return false if at end of entire tree.
+    bool nextNode()
+    {
+      if (_node != kNoNode)
+      {
+        const Node& n = _tree->node(_node);
+        if (!n.isLeaf())
+        {
+          _parent = _node;
+          _node = n._firstChild;
+          _depth++;
+        }
+        else
+        {
+          _node = n._nextSibling;
+        }
+      }
+      else
+      {
+        if (_parent == kRootNode) return false;
+        _node = _tree->node(_parent)._nextSibling;
+        _parent = _tree->node(_parent)._parent;
+        _depth--;
+      }
+      return true;
+    }
+
+    // go to the first child of the current node, or if at end of the siblings,
+    // reset to the first sibling. This works like Tree::const_iterator::firstChild().
+    void firstChild()
+    {
+      if (_node != kNoNode)
+      {
+        const Node& n = _tree->node(_node);
+        if (!n.isLeaf())
+        {
+          _parent = _node;
+          _node = n._firstChild;
+          _depth++;
+        }
+        else
+        {
+          _node = kNoNode;
+        }
+      }
+      else
+      {
+        _node = _tree->node(_parent)._firstChild;
+      }
+    }
+
+    // will nextChild() iterate to more children?
+    bool hasMoreChildren() const { return !atEndOfMap(); }
+
+    // advance to the next child of the current parent node.
+    void nextChild() { _node = _tree->node(_node)._nextSibling; }
+
+    bool currentNodeHasValue() const
+    {
+      return (_node != kNoNode) && _tree->node(_node).hasValue();
+    }
+
+    // advance to the next node that has a value
+    const const_iterator& operator++()
+    {
+      while (nextNode())
+      {
+        if (currentNodeHasValue()) break;
+      }
+      return *this;
+    }
+
+    size_t getCurrentDepth() const { return _depth; }
+
+    // return the last symbol of the current node path.
+    Symbol getCurrentNodeName() const
+    {
+      return (_node != kNoNode) ? _tree->node(_node)._name : Symbol();
+    }
+
+    // return the entire path to the current node, or to its parent if at the
+    // end of the siblings.
+    Path getCurrentPath() const
+    {
+      std::array<Symbol, kPathMaxSymbols> names;
+      int n = 0;
+      for (NodeIndex i = (_node != kNoNode) ? _node : _parent; (i != kRootNode) && (n < kPathMaxSymbols);
+           i = _tree->node(i)._parent)
+      {
+        names[n++] = _tree->node(i)._name;
+      }
+      Path p;
+      while (n > 0)
+      {
+        p = Path(p, Path(names[--n]));
+      }
+      return p;
+    }
+
+    // sets path to root, after which firstChild() will go to the first node in the tree.
+    void setCurrentPathToRoot()
+    {
+      _parent = kRootNode;
+      _node = kNoNode;
+      _depth = 0;
+    }
+
+    // Try to set current node to the path p. Return true if successful.
+    // If unsuccessful the current path is set to root.
+    bool setCurrentPath(Path p)
+    {
+      setCurrentPathToRoot();
+      if (!p) return true;
+      NodeIndex n = _tree->findNode(p);
+      if (n == kNoNode) return false;
+      _node = n;
+      _parent = _tree->node(n)._parent;
+      _depth = p.getSize() - 1;
+      return true;
+    }
+  };
+
+  // start at beginning, then advance until a node with a value is reached.
+  inline const_iterator begin() const
+  {
+    auto it = const_iterator(this, node(kRootNode)._firstChild);
+    if (!it.atEndOfMap() && !it.currentNodeHasValue())
+    {
+      ++it;
+    }
+    return it;
+  }
+
+  inline const_iterator beginAtRoot() const { return const_iterator(this, kNoNode); }
+
+  inline const_iterator end() const { return const_iterator(this, kNoNode); }
+
+  // visit all nodes and dump only the nodes with values.
+  inline void dump() const
+  {
+    for (auto it = begin(); it != end(); ++it)
+    {
+      std::cout << it.getCurrentPath() << " [" << *it << "] \n";
+    }
+  }
+
+  // count the nodes with values, including the root.
+  inline size_t size() const
+  {
+    size_t sum{0};
+    for (NodeIndex i = 0; i < _nodesUsed; ++i)
+    {
+      sum += node(i).hasValue();
+    }
+    return sum;
+  }
+};
+
+}  // namespace ml
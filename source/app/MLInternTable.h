@@ -0,0 +1,205 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020-2022 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// InternTable: the storage behind SymbolTable and PathTable, which store each
+// distinct key once and give it a small integer ID.
+//
+// Entries are kept in ID order in chunks of 2^CHUNK_BITS entries. Chunks are
+// never moved or freed while the table is in use, so references to entries
+// stay valid while other threads add more. IDs are found through an
+// open-addressed hash table, probed linearly from each hash, with 0 marking an
+// empty slot. ID 0 is the null key and is never in the hash table. When the
+// hash table gets half full it is replaced with one twice the size. Old tables
+// are kept until clear() so that readers still using them are safe.
+//
+// Finding an existing entry takes no locks. Adding entries is serialized by a
+// single mutex. Entry must be default-constructible and have a uint64_t member
+// named hash.
+
+namespace ml
+{
+template <class Entry, class ID, int CHUNK_BITS, int MAX_CHUNKS>
+class InternTable
+{
+ public:
+  static constexpr size_t kChunkSize{size_t(1) << CHUNK_BITS};
+  static constexpr size_t kChunkMask{kChunkSize - 1};
+
+  // allocate chunks for the initial number of entries up front, and start
+  // with a hash table of 2^hashBits slots.
+  InternTable(size_t initialEntries, int hashBits) : _hashBits(hashBits)
+  {
+    size_t nChunks = std::max((initialEntries + kChunkMask) >> CHUNK_BITS, size_t(1));
+    for (size_t i = 0; i < std::min(nChunks, size_t(MAX_CHUNKS)); ++i)
+    {
+      _chunks[i].store(new Entry[kChunkSize], std::memory_order_release);
+    }
+  }
+
+  ~InternTable()
+  {
+    for (auto& chunk : _chunks)
+    {
+      delete[] chunk.load(std::memory_order_acquire);
+    }
+  }
+
+  InternTable(const InternTable&) = delete;
+  InternTable& operator=(const InternTable&) = delete;
+
+  size_t size() const { return _size.load(std::memory_order_acquire); }
+
+  inline Entry& getEntry(ID id)
+  {
+    Entry* pChunk = _chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    return pChunk[id & kChunkMask];
+  }
+
+  // the mutex held while adding entries.
+  std::mutex& getAddMutex() { return _addMutex; }
+
+  // remove all entries but the null entry, which gets the given hash. Each
+  // entry in use is reset with resetEntry(Entry&). Allocated chunks are kept
+  // for reuse. Not thread-safe: no other threads can be using the table.
+  template <class Reset>
+  void clear(uint64_t nullHash, Reset resetEntry)
+  {
+    std::unique_lock<std::mutex> lock(_addMutex);
+
+    size_t n = size();
+    for (size_t i = 0; i < n; ++i)
+    {
+      resetEntry(getEntry(static_cast<ID>(i)));
+    }
+
+    _hashTables.clear();
+    _hashTables.emplace_back(std::make_unique<HashTable>(size_t(1) << _hashBits));
+    _hashTable.store(_hashTables.back().get(), std::memory_order_release);
+
+    getEntry(0).hash = nullHash;
+    _size.store(1, std::memory_order_release);
+  }
+
+  // find an existing entry without locking. match(const Entry&) returns true
+  // for the entry being looked for, and is only called for entries with the
+  // same hash. Returns 0 if not found.
+  template <class Match>
+  ID find(uint64_t h, Match match)
+  {
+    const HashTable* pTable = _hashTable.load(std::memory_order_acquire);
+    for (size_t i = h & pTable->mask;; i = (i + 1) & pTable->mask)
+    {
+      ID id = pTable->slots[i].load(std::memory_order_acquire);
+      if (!id) return 0;
+      Entry& e = getEntry(id);
+      if ((e.hash == h) && match(e)) return id;
+    }
+  }
+
+  // add an entry if it does not exist already, and return its ID. This must
+  // be the only way of adding to the table. init(Entry&) stores the key in the
+  // new entry, which is complete before it is published to readers by the
+  // store to the hash table. Returns 0 if the table is full.
+  template <class Match, class Init>
+  ID add(uint64_t h, Match match, Init init)
+  {
+    std::unique_lock<std::mutex> lock(_addMutex);
+
+    // another thread may have added the key since we looked.
+    ID r = find(h, match);
+    if (r) return r;
+
+    size_t n = _size.load(std::memory_order_relaxed);
+    size_t chunkIndex = n >> CHUNK_BITS;
+    if (chunkIndex >= MAX_CHUNKS)
+    {
+      // table is full
+      return 0;
+    }
+    if (!_chunks[chunkIndex].load(std::memory_order_relaxed))
+    {
+      _chunks[chunkIndex].store(new Entry[kChunkSize], std::memory_order_release);
+    }
+
+    r = static_cast<ID>(n);
+    Entry& e = getEntry(r);
+    init(e);
+    e.hash = h;
+
+    HashTable* pTable = _hashTable.load(std::memory_order_relaxed);
+    if ((n + 1) * 2 > pTable->mask + 1)
+    {
+      // make a bigger table with all the IDs so far, then publish it.
+      auto pNewTable = std::make_unique<HashTable>((pTable->mask + 1) * 2);
+      for (size_t i = 1; i <= n; ++i)
+      {
+        insertID(*pNewTable, static_cast<ID>(i));
+      }
+      _hashTable.store(pNewTable.get(), std::memory_order_release);
+      _hashTables.emplace_back(std::move(pNewTable));
+    }
+    else
+    {
+      insertID(*pTable, r);
+    }
+    _size.store(n + 1, std::memory_order_release);
+    return r;
+  }
+
+  // call f(slot, id) for each ID in the current hash table, in slot order.
+  template <class F>
+  void forEachSlot(F f) const
+  {
+    const HashTable* pTable = _hashTable.load(std::memory_order_acquire);
+    for (size_t i = 0; i <= pTable->mask; ++i)
+    {
+      ID id = pTable->slots[i].load(std::memory_order_acquire);
+      if (id) f(i, id);
+    }
+  }
+
+ private:
+  struct HashTable
+  {
+    explicit HashTable(size_t size) : mask(size - 1), slots(new std::atomic<ID>[size]()) {}
+    const size_t mask;
+    std::unique_ptr<std::atomic<ID>[]> slots;
+  };
+
+  // put an ID in the first empty slot at or after its hash.
+  void insertID(HashTable& table, ID id)
+  {
+    size_t i = getEntry(id).hash & table.mask;
+    while (table.slots[i].load(std::memory_order_relaxed))
+    {
+      i = (i + 1) & table.mask;
+    }
+    table.slots[i].store(id, std::memory_order_release);
+  }
+
+  const int _hashBits;
+
+  // entries in ID / creation order.
+  std::array<std::atomic<Entry*>, MAX_CHUNKS> _chunks{};
+
+  // the current hash table, and all the tables made since clear().
+  std::atomic<HashTable*> _hashTable{nullptr};
+  std::vector<std::unique_ptr<HashTable> > _hashTables;
+
+  std::mutex _addMutex;
+  std::atomic<size_t> _size{0};
+};
+
+}  // namespace ml
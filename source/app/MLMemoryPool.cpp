@@ -0,0 +1,138 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020-2022 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "MLMemoryPool.h"
+
+#include <cstdlib>
+
+namespace ml
+{
+namespace
+{
+constexpr uintptr_t kArenaAlignment{64};
+
+inline size_t sizeClassIndex(size_t bytes)
+{
+  size_t c = 0;
+  while ((MemoryPool::kMinBlockSize << c) < bytes)
+  {
+    c++;
+  }
+  return c;
+}
+}  // namespace
+
+MemoryPool::MemoryPool(size_t arenaBytes)
+{
+  // round the arenas up to a whole number of the largest blocks.
+  _arenaBytes = ((arenaBytes + kMaxBlockSize - 1) / kMaxBlockSize) * kMaxBlockSize;
+  _pMemory = malloc(_arenaBytes * kNumSizeClasses + kArenaAlignment - 1);
+  if (!_pMemory) return;
+  uintptr_t pArenas = reinterpret_cast<uintptr_t>(_pMemory);
+  pArenas = (pArenas + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+  _pArenas = reinterpret_cast<uint8_t*>(pArenas);
+
+  for (size_t c = 0; c < kNumSizeClasses; ++c)
+  {
+    SizeClass& s = _sizeClasses[c];
+    s.blocks = _pArenas + c * _arenaBytes;
+    s.capacity = static_cast<uint32_t>(_arenaBytes >> (kMinBlockSizeBits + c));
+    s.nextFree = std::unique_ptr<std::atomic<uint32_t>[]>(new std::atomic<uint32_t>[s.capacity]);
+    for (uint32_t i = 0; i < s.capacity; ++i)
+    {
+      s.nextFree[i] = (i + 1 < s.capacity) ? i + 1 : kNoBlock;
+    }
+    s.head = 0;
+  }
+}
+
+MemoryPool::~MemoryPool() { free(_pMemory); }
+
+void* MemoryPool::pop(size_t sizeClass)
+{
+  SizeClass& s = _sizeClasses[sizeClass];
+  uint64_t head = s.head.load(std::memory_order_acquire);
+  uint32_t block;
+  while (true)
+  {
+    block = static_cast<uint32_t>(head);
+    if (block == kNoBlock) return nullptr;
+
+    // if another thread takes this block first, the change count in the head
+    // will differ and the exchange will fail.
+    uint64_t next = s.nextFree[block].load(std::memory_order_relaxed);
+    uint64_t newHead = (((head >> 32) + 1) << 32) | next;
+    if (s.head.compare_exchange_weak(head, newHead, std::memory_order_acq_rel,
+                                     std::memory_order_acquire))
+      break;
+  }
+
+  size_t inUse = s.inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+  size_t highWater = s.highWater.load(std::memory_order_relaxed);
+  while ((inUse > highWater) &&
+         !s.highWater.compare_exchange_weak(highWater, inUse, std::memory_order_relaxed))
+  {
+  }
+  return s.blocks + (static_cast<size_t>(block) << (kMinBlockSizeBits + sizeClass));
+}
+
+void MemoryPool::push(size_t sizeClass, uint32_t block)
+{
+  SizeClass& s = _sizeClasses[sizeClass];
+  uint64_t head = s.head.load(std::memory_order_relaxed);
+  uint64_t newHead;
+  do
+  {
+    s.nextFree[block].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+    newHead = (((head >> 32) + 1) << 32) | block;
+  } while (!s.head.compare_exchange_weak(head, newHead, std::memory_order_release,
+                                         std::memory_order_relaxed));
+  s.inUse.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void* MemoryPool::allocate(size_t bytes)
+{
+  size_t c = sizeClassIndex(bytes);
+  if (_pArenas && (c < kNumSizeClasses))
+  {
+    if (void* p = pop(c)) return p;
+  }
+  _fallbacks.fetch_add(1, std::memory_order_relaxed);
+  return malloc(bytes);
+}
+
+void MemoryPool::deallocate(void* p)
+{
+  if (!p) return;
+  uint8_t* pBytes = static_cast<uint8_t*>(p);
+  if ((pBytes >= _pArenas) && (pBytes < _pArenas + _arenaBytes * kNumSizeClasses))
+  {
+    size_t offset = pBytes - _pArenas;
+    size_t c = offset / _arenaBytes;
+    uint32_t block = static_cast<uint32_t>((offset - c * _arenaBytes) >> (kMinBlockSizeBits + c));
+    push(c, block);
+  }
+  else
+  {
+    free(p);
+  }
+}
+
+MemoryPool::Stats MemoryPool::getStats() const
+{
+  Stats stats;
+  for (size_t c = 0; c < kNumSizeClasses; ++c)
+  {
+    const SizeClass& s = _sizeClasses[c];
+    SizeClassStats& r = stats.sizeClasses[c];
+    r.blockSize = kMinBlockSize << c;
+    r.capacity = s.capacity;
+    r.inUse = s.inUse.load(std::memory_order_relaxed);
+    r.highWater = s.highWater.load(std::memory_order_relaxed);
+  }
+  stats.fallbacks = _fallbacks.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace ml
@@ -0,0 +1,106 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020-2022 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// MemoryPool: a lock-free allocator for the out-of-line data of Text, Value
+// and Matrix objects, so that they can be made and destroyed on real-time
+// threads. The pool has an arena of blocks for each power-of-two size class
+// from kMinBlockSize to kMaxBlockSize, all allocated when the pool is made.
+// Each arena keeps its free blocks on a lock-free stack. Requests that are too
+// large for any size class, or that find their arena empty, fall back to
+// malloc() and are counted in the Stats.
+//
+// Any thread may free memory allocated by any other thread.
+
+namespace ml
+{
+class MemoryPool
+{
+ public:
+  static constexpr size_t kMinBlockSizeBits{5};
+  static constexpr size_t kMaxBlockSizeBits{13};
+  static constexpr size_t kMinBlockSize{1 << kMinBlockSizeBits};
+  static constexpr size_t kMaxBlockSize{1 << kMaxBlockSizeBits};
+  static constexpr size_t kNumSizeClasses{kMaxBlockSizeBits - kMinBlockSizeBits + 1};
+  static constexpr size_t kDefaultArenaBytes{1 << 17};
+
+  struct SizeClassStats
+  {
+    size_t blockSize{0};
+    size_t capacity{0};
+    size_t inUse{0};
+    size_t highWater{0};
+  };
+
+  struct Stats
+  {
+    std::array<SizeClassStats, kNumSizeClasses> sizeClasses;
+
+    // number of allocations that were made with malloc() because their size
+    // class was full or they were too large for the pool.
+    size_t fallbacks{0};
+  };
+
+  // make a pool with the given number of bytes in the arena of each size class.
+  explicit MemoryPool(size_t arenaBytes = kDefaultArenaBytes);
+  ~MemoryPool();
+
+  MemoryPool(const MemoryPool&) = delete;
+  MemoryPool& operator=(const MemoryPool&) = delete;
+
+  // allocate at least the given number of bytes. Returns nullptr only if the
+  // pool is full and malloc() fails.
+  void* allocate(size_t bytes);
+
+  // free memory returned by allocate(). A null pointer is ignored.
+  void deallocate(void* p);
+
+  Stats getStats() const;
+
+ private:
+  static constexpr uint32_t kNoBlock{0xFFFFFFFF};
+
+  struct SizeClass
+  {
+    uint8_t* blocks{nullptr};
+    uint32_t capacity{0};
+
+    // index of the next free block after each free block.
+    std::unique_ptr<std::atomic<uint32_t>[]> nextFree;
+
+    // the top of the free stack: a 32-bit change count in the high bits, to
+    // prevent ABA problems, and the index of the first free block.
+    std::atomic<uint64_t> head{kNoBlock};
+
+    std::atomic<size_t> inUse{0};
+    std::atomic<size_t> highWater{0};
+  };
+
+  void* pop(size_t sizeClass);
+  void push(size_t sizeClass, uint32_t block);
+
+  void* _pMemory{nullptr};
+  uint8_t* _pArenas{nullptr};
+  size_t _arenaBytes{0};
+  std::array<SizeClass, kNumSizeClasses> _sizeClasses;
+  std::atomic<size_t> _fallbacks{0};
+};
+
+// the pool used by Text, Value and Matrix. It is made on first use, so call
+// this once before starting any real-time threads. It is never destroyed, so
+// that static objects holding pooled memory can be destroyed safely at exit.
+inline MemoryPool& theMemoryPool()
+{
+  static MemoryPool* const t(new MemoryPool());
+  return *t;
+}
+
+}  // namespace ml
@@ -4,6 +4,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+#include "MLDSPMath.h"
 #include "MLPropertyTree.h"
 //#include "madronalib.h"
 //#include "mldsp.h"
@@ -15,73 +20,198 @@ using ParameterDescription = PropertyTree;
 
 using ParameterDescriptionList = std::vector< std::unique_ptr< ParameterDescription> >;
 
-struct ParameterProjection
+// ParameterConversion: the mapping between normalized and real values for one
+// parameter, compiled once from its description. Converting needs no text
+// parsing or std::function calls, just a switch on the type and a few constants.
+
+struct ParameterConversion
 {
-  Projection normalizedToReal{projections::unity};
-  Projection realToNormalized{projections::unity};
+  enum Type
+  {
+    kLinear = 0,
+    kLog,
+    kBisquare,
+    kList
+  };
+
+  Type type{kLinear};
+
+  // real range
+  float a{0.f};
+  float b{1.f};
+
+  // log params: real = a*exp(logRatio*x) + offset
+  float offset{0.f};
+  float logRatio{0.f};
+
+  // list params
+  size_t nItems{0};
+  bool useListValues{false};
+  std::vector<int> listValues;
+
+  float normalizedToReal(float x) const
+  {
+    switch (type)
+    {
+      case kLinear:
+      default:
+        return a + x * (b - a);
+      case kLog:
+        return a * expf(logRatio * x) + offset;
+      case kBisquare:
+      {
+        float y = a + x * (b - a);
+        return fabsf(y) * y;
+      }
+      case kList:
+      {
+        float index = (nItems > 1) ? floorf(fminf(nItems - 1.f, x * nItems)) : 0.f;
+        if (!useListValues || listValues.empty()) return index;
+        int i = ml::clamp(static_cast<int>(index), 0, (int)listValues.size() - 1);
+        return (float)listValues[i];
+      }
+    }
+  }
+
+  float realToNormalized(float r) const
+  {
+    switch (type)
+    {
+      case kLinear:
+      default:
+        return (b != a) ? (r - a) / (b - a) : 0.f;
+      case kLog:
+        if (b == a) return a;
+        if (a == 0.f) return 0.f;
+        return logf((r - offset) / a) / logRatio;
+      case kBisquare:
+        return (b != a) ? (sqrtf(fabsf(r)) * sign(r) - a) / (b - a) : 0.f;
+      case kList:
+      {
+        if (nItems <= 1) return 0.f;
+        float index = r;
+        if (useListValues)
+        {
+          // get item matching plain value
+          auto it = std::find(listValues.begin(), listValues.end(), static_cast<int>(r));
+          if ((it == listValues.end()) || (*it != r)) return 0.f;
+          index = static_cast<float>(it - listValues.begin());
+        }
+        return index / (nItems - 1);
+      }
+    }
+  }
+
+  // convert n normalized values to real values. Linear, log and bisquare
+  // conversions are done four values at a time.
+  void normalizedToReal(const float* pSrc, float* pDest, size_t n) const
+  {
+    size_t i = 0;
+    if (type != kList)
+    {
+      const SIMDVectorFloat va = vecSet1(a);
+      const SIMDVectorFloat vRange = vecSet1(b - a);
+      const SIMDVectorFloat vRatio = vecSet1(logRatio);
+      const SIMDVectorFloat vOffset = vecSet1(offset);
+      for (; i + kFloatsPerSIMDVector <= n; i += kFloatsPerSIMDVector)
+      {
+        SIMDVectorFloat x = vecLoadUnaligned(pSrc + i);
+        SIMDVectorFloat y;
+        switch (type)
+        {
+          case kLinear:
+          default:
+            y = vecAdd(va, vecMul(x, vRange));
+            break;
+          case kLog:
+            y = vecAdd(vecMul(va, vecExp(vecMul(vRatio, x))), vOffset);
+            break;
+          case kBisquare:
+            y = vecAdd(va, vecMul(x, vRange));
+            y = vecMul(vecAbs(y), y);
+            break;
+        }
+        vecStoreUnaligned(pDest + i, y);
+      }
+    }
+    for (; i < n; ++i)
+    {
+      pDest[i] = normalizedToReal(pSrc[i]);
+    }
+  }
 };
 
-inline ParameterProjection createParameterProjection(const ParameterDescription& p)
+inline ParameterConversion compileParameterConversion(const ParameterDescription& p)
 {
-  ParameterProjection b;
+  ParameterConversion c;
   auto units = Symbol(p.getProperty("units").getTextValue());
   bool bLog = p.getProperty("log").getBoolValueWithDefault(false);
   bool bisquare = p.getProperty("bisquare").getBoolValueWithDefault(false);
   Matrix range = p.getProperty("range").getMatrixValueWithDefault({0, 1});
-  float offset = p.getProperty("offset").getFloatValueWithDefault(0.f);
+  c.a = range[0];
+  c.b = range[1];
 
-  Interval normalRange{0., 1.};
-  Interval plainRange{range[0], range[1]};
-  
-  // make ranges for list parameters
   if (units == "list")
   {
+    c.type = ParameterConversion::kList;
+    
     // get number of items
-    size_t nItems{0};
     if (p.hasProperty("listitems"))
     {
-      // read and count list items
+      // read and count list items, and parse them if needed
       auto listItems = textUtils::split(p.getTextProperty("listitems"), '/');
-      nItems = listItems.size();
+      c.nItems = listItems.size();
+      c.useListValues = p.getBoolPropertyWithDefault("use_list_values_as_int", false);
+      if (c.useListValues)
+      {
+        for (const auto& item : listItems)
+        {
+          c.listValues.push_back(textUtils::textToNaturalNumber(item));
+        }
+      }
     }
     else if (p.hasProperty("num_items"))
     {
-      nItems = (size_t)p.getFloatProperty("num_items");
-    }
-    
-    if (nItems <= 1)
-    {
-      b.normalizedToReal = projections::zero;
-      b.realToNormalized = projections::zero;
-    }
-    else
-    {
-      size_t stepCount = nItems - 1;
-      b.normalizedToReal = [=](float x) { return (floorf(fmin((float)stepCount, (float)(x * nItems)))); };
-      b.realToNormalized = [=](float x) { return (x / stepCount); };
+      c.nItems = (size_t)p.getFloatProperty("num_items");
     }
   }
-  else
+  else if (bLog)
   {
-    if(bLog)
-    {
-      b.normalizedToReal =
-      compose(projections::add(offset), projections::intervalMap(normalRange, plainRange, projections::log(plainRange)));
-      
-      b.realToNormalized =
-      compose(projections::intervalMap(plainRange, normalRange, projections::exp(plainRange)), projections::add(-offset));
-    }
-    else if(bisquare)
+    c.type = ParameterConversion::kLog;
+    c.offset = p.getProperty("offset").getFloatValueWithDefault(0.f);
+    if ((c.a == 0.f) || (c.b == c.a))
     {
-      b.normalizedToReal = compose(projections::bisquared, projections::linear(normalRange, plainRange));
-      b.realToNormalized = compose(projections::linear(plainRange, normalRange), projections::invBisquared);
+      // the log mapping is constant at a in these cases
+      c.logRatio = 0.f;
     }
     else
     {
-      b.normalizedToReal = projections::linear(normalRange, plainRange);
-      b.realToNormalized = projections::linear(plainRange, normalRange);
+      c.logRatio = logf(c.b / c.a);
     }
   }
+  else if (bisquare)
+  {
+    c.type = ParameterConversion::kBisquare;
+  }
+  return c;
+}
+
+struct ParameterProjection
+{
+  Projection normalizedToReal{projections::unity};
+  Projection realToNormalized{projections::unity};
+};
+
+// make projections from a compiled conversion. For list parameters these
+// project to and from the item index, not the list value.
+inline ParameterProjection createParameterProjection(const ParameterDescription& p)
+{
+  ParameterProjection b;
+  ParameterConversion c = compileParameterConversion(p);
+  c.useListValues = false;
+  c.listValues.clear();
+  b.normalizedToReal = [=](float x) { return c.normalizedToReal(x); };
+  b.realToNormalized = [=](float x) { return c.realToNormalized(x); };
   return b;
 }
 
@@ -91,58 +221,22 @@ class ParameterTree
 public:
   Tree< std::unique_ptr< ParameterDescription > > descriptions;
   Tree< ParameterProjection > projections;
+  Tree< ParameterConversion > conversions;
   Tree< Value > paramsNorm_;
   Tree< Value > paramsReal_;
   
   float convertNormalizedToRealFloatValue(Path pname, Value val) const
   {
-    float newNormValue = val.getFloatValue();
-    float newRealValue{0};
     auto& pdesc = descriptions[pname];
     if(!pdesc) return 0;
-    
-    bool useListValues = pdesc->getBoolPropertyWithDefault("use_list_values_as_int", false);
-    if(useListValues)
-    {
-      auto listItems = textUtils::split(pdesc->getTextProperty("listitems"), '/');
-      int itemIndex = (int)(projections[pname].normalizedToReal(newNormValue));
-      newRealValue = (float)textUtils::textToNaturalNumber(listItems[itemIndex]);
-    }
-    else
-    {
-      newRealValue = (float)projections[pname].normalizedToReal(newNormValue);
-    }
-    return newRealValue;
+    return conversions[pname].normalizedToReal(val.getFloatValue());
   }
 
   float convertRealToNormalizedFloatValue(Path pname, Value val) const
   {
-    float newNormValue{0};
-    float newRealValue = val.getFloatValue();
     auto& pdesc = descriptions[pname];
     if(!pdesc) return 0;
-
-    bool useListValues = pdesc->getBoolPropertyWithDefault("use_list_values_as_int", false);
-    if(useListValues)
-    {
-      auto listItems = textUtils::split(pdesc->getTextProperty("listitems"), '/');
-      
-      // get item matching plain value
-      for(int i=0; i<listItems.size(); ++i)
-      {
-        int intItem = textUtils::textToNaturalNumber(listItems[i]);
-        if(newRealValue == intItem)
-        {
-          newNormValue = projections[pname].realToNormalized((float)i);
-          break;
-        }
-      }
-    }
-    else
-    {
-      newNormValue = projections[pname].realToNormalized(newRealValue);
-    }
-    return newNormValue;
+    return conversions[pname].realToNormalized(val.getFloatValue());
   }
   
   inline Value convertNormalizedToRealValue(Path pname, Value val) const
@@ -297,6 +391,92 @@ protected:
 };
 
 
+// ParamHandle refers to a parameter by its dense ID, assigned in list order
+// when parameters are built. Resolve handles from Paths once at setup, then use
+// them for constant time access while processing.
+
+struct ParamHandle
+{
+  static constexpr size_t kNoID{~size_t(0)};
+  size_t id{kNoID};
+
+  explicit operator bool() const { return id != kNoID; }
+};
+
+inline bool operator==(ParamHandle a, ParamHandle b) { return a.id == b.id; }
+inline bool operator!=(ParamHandle a, ParamHandle b) { return a.id != b.id; }
+
+// ParameterSnapshot publishes flat arrays of real and normalized parameter
+// values, indexed by parameter ID, from control threads to the audio thread.
+// It's a triple buffer: the writer fills its own copy and publishes it with one
+// atomic exchange, and the reader picks up the most recently published copy the
+// same way. Neither side ever waits for the other. Only one thread may write at
+// a time, and only one thread may read.
+
+class ParameterSnapshot
+{
+ public:
+  struct Values
+  {
+    std::vector<float> real;
+    std::vector<float> normalized;
+  };
+
+  // allocates memory, so call this before processing.
+  void resize(size_t n)
+  {
+    _values.real.assign(n, 0.f);
+    _values.normalized.assign(n, 0.f);
+    for (auto& b : _buffers)
+    {
+      b = _values;
+    }
+    _writeIndex = 0;
+    _middle.store(1);
+    _readIndex = 2;
+  }
+
+  size_t size() const { return _values.real.size(); }
+
+  // writer side: set a value, then publish() to make all changes visible.
+  void setValue(size_t id, float real, float normalized)
+  {
+    if (id < size())
+    {
+      _values.real[id] = real;
+      _values.normalized[id] = normalized;
+    }
+  }
+
+  void publish()
+  {
+    auto& b = _buffers[_writeIndex];
+    std::copy(_values.real.begin(), _values.real.end(), b.real.begin());
+    std::copy(_values.normalized.begin(), _values.normalized.end(), b.normalized.begin());
+    _writeIndex = _middle.exchange(_writeIndex | kNewData, std::memory_order_acq_rel) & kIndexMask;
+  }
+
+  // reader side: get the most recently published values.
+  const Values& read()
+  {
+    if (_middle.load(std::memory_order_relaxed) & kNewData)
+    {
+      _readIndex = _middle.exchange(_readIndex, std::memory_order_acq_rel) & kIndexMask;
+    }
+    return _buffers[_readIndex];
+  }
+
+ private:
+  static constexpr int kIndexMask{3};
+  static constexpr int kNewData{4};
+
+  Values _values;
+  std::array<Values, 3> _buffers;
+  std::atomic<int> _middle{1};
+  int _writeIndex{0};
+  int _readIndex{2};
+};
+
 // functions on ParameterTrees.
 
 // set the description of the parameter paramName in the tree paramTree to paramDesc.
@@ -304,6 +484,7 @@ inline void setParameterInfo(ParameterTree& paramTree, Path paramName,
                              const ParameterDescription& paramDesc)
 {
   paramTree.projections[paramName] = createParameterProjection(paramDesc);
+  paramTree.conversions[paramName] = compileParameterConversion(paramDesc);
   paramTree.descriptions[paramName] = std::make_unique<ParameterDescription>(paramDesc);
 }
 
@@ -238,4 +238,31 @@ Path substitute(Path p, Symbol fromSymbol, Path toPath)
   return r;
 }
 
+// PathTable
+
+PathTable::PathTable() : mEntries(0, kDefaultPathHashTableBits) { clear(); }
+
+PathTable::~PathTable() = default;
+
+void PathTable::clear()
+{
+  // ID 0 is the empty path.
+  mEntries.clear(hash(Path()), [](Entry& e) { e.path = Path(); });
+}
+
+PathIDValue PathTable::getPathID(const Path& p)
+{
+  if (!p) return 0;
+  uint64_t h = hash(p);
+  auto match = [&p](const Entry& e) { return e.path == p; };
+
+  // store the path without its copy number.
+  auto init = [&p](Entry& e) {
+    e.path = p;
+    e.path.setCopy(0);
+  };
+  PathIDValue r = mEntries.find(h, match);
+  return r ? r : mEntries.add(h, match, init);
+}
+
 }  // namespace ml
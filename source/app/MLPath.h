@@ -6,6 +6,7 @@
 
 #include <numeric>
 
+#include "MLInternTable.h"
 #include "MLSymbol.h"
 #include "MLTextUtils.h"
 // a Path describes the address of one or more elements in a tree
@@ -161,30 +162,127 @@ inline bool operator==(const Path& a, const Path& b)
 
 inline bool operator!=(const Path a, const Path b) { return !(a == b); }
 
+// hash the Symbols of a Path. Like operator==, this ignores the copy number.
+inline uint64_t hash(const Path& p)
+{
+  uint64_t accum = kFNVOffsetBasis;
+  for (Symbol s : p)
+  {
+    accum ^= s.getID();
+    accum *= kFNVPrime;
+  }
+  return accum;
+}
+
+// ----------------------------------------------------------------
+#pragma mark PathID
+
+using PathIDValue = uint32_t;
+
+// paths are stored in chunks of 2^kPathChunkBits entries, up to
+// kMaxPathChunks chunks. The hash table of path IDs starts with
+// 2^kDefaultPathHashTableBits slots and grows as needed.
+constexpr int kPathChunkBits = 8;
+constexpr int kMaxPathChunks = (1 << 12);
+constexpr int kDefaultPathHashTableBits = 10;
+
+// PathTable: stores each distinct Path once and gives it an ID, in the same way
+// as SymbolTable. Looking up existing paths takes no locks. Adding a path is
+// serialized by a single mutex.
+
+class PathTable
+{
+  friend class PathID;
+
+ public:
+  PathTable();
+  ~PathTable();
+
+  // clear all paths. Not thread-safe: no other threads can be using PathIDs.
+  void clear();
+  size_t getSize() { return mEntries.size(); }
+
+ protected:
+  PathIDValue getPathID(const Path& p);
+  const Path& getPathByID(PathIDValue pathID) { return mEntries.getEntry(pathID).path; }
+
+ private:
+  struct Entry
+  {
+    Path path;
+    uint64_t hash{0};
+  };
+
+  InternTable<Entry, PathIDValue, kPathChunkBits, kMaxPathChunks> mEntries;
+};
+
+inline PathTable& thePathTable()
+{
+  static const std::unique_ptr<PathTable> t(new PathTable());
+  return *t;
+}
+
+// PathID: an interned Path. Each distinct Path gets a small integer ID the first
+// time it is seen, so PathIDs can be compared and hashed in O(1), and used as
+// keys or indexes in flat containers. The Path is only needed again when
+// getPath() is called. Copy numbers are not part of a PathID.
+
+class PathID
+{
+  // the ID equals the order in which the path was first seen.
+  PathIDValue id;
+
+ public:
+  PathID() : id(0) {}
+  explicit PathID(const Path& p) : id(thePathTable().getPathID(p)) {}
+
+  inline bool operator<(const PathID b) const { return (id < b.id); }
+  inline bool operator==(const PathID b) const { return (id == b.id); }
+  inline bool operator!=(const PathID b) const { return (id != b.id); }
+  explicit operator bool() const { return id != 0; }
+
+  PathIDValue getID() const { return id; }
+  const Path& getPath() const { return thePathTable().getPathByID(id); }
+};
+
+inline uint64_t hash(PathID p) { return p.getID(); }
+
 inline TextFragment pathToText(Path p, const char separator = '/')
 {
-  TextFragment r;
   auto n = p.getSize();
-  if (n < 1) return r;
-  r = p.getElement(0).getTextFragment();
+  if (n < 1) return TextFragment();
+  size_t totalLength = n - 1;
+  for (Symbol s : p)
+  {
+    totalLength += s.getTextFragment().lengthInBytes();
+  }
+  TextBuilder b;
+  b.reserve(totalLength);
+  b.append(p.getElement(0).getTextFragment());
   for (int i = 1; i < n; ++i)
   {
-    r = TextFragment(r, separator);
-    r = TextFragment(r, p.getElement(i).getTextFragment());
+    b.append(&separator, 1);
+    b.append(p.getElement(i).getTextFragment());
   }
-  return r;
+  return std::move(b).takeText();
 }
 
 inline TextFragment rootPathToText(Path p, const char separator = '/')
 {
-  TextFragment r;
   auto n = p.getSize();
+  size_t totalLength = n;
+  for (Symbol s : p)
+  {
+    totalLength += s.getTextFragment().lengthInBytes();
+  }
+  TextBuilder b;
+  b.reserve(totalLength);
   for (int i = 0; i < n; ++i)
   {
-    r = TextFragment(r, separator);
-    r = TextFragment(r, p.getElement(i).getTextFragment());
+    b.append(&separator, 1);
+    b.append(p.getElement(i).getTextFragment());
   }
-  return r;
+  return std::move(b).takeText();
 }
 
 inline Path textToPath(TextFragment t, const char separator = '/')
@@ -212,3 +310,14 @@ inline Path addExtensionToPath(Path p, TextFragment ext)
 
 
 }  // namespace ml
+
+// hashing function for ml::PathID use in unordered STL containers. The ID is
+// unique for each path.
+namespace std
+{
+template <>
+struct hash<ml::PathID>
+{
+  std::size_t operator()(const ml::PathID& p) const { return p.getID(); }
+};
+}  // namespace std
@@ -0,0 +1,389 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020-2022 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "MLPath.h"
+#include "MLTree.h"
+#include "MLValue.h"
+#include "MLValueChange.h"
+
+// PersistentTree: a Tree in which nodes are shared between copies. Copying a
+// PersistentTree is O(1), so it can be used to take snapshots of a tree for
+// undo or comparison. Modifying a tree copies only the nodes on the path to the
+// change that are shared with another tree. Two trees can be compared with
+// forEachChange(), which skips any subtrees the trees still share, so the cost
+// of a diff between snapshots is proportional to the number of changes.
+//
+// Values must be copyable. As with Tree, a value equal to V() is considered
+// to be no value.
+
+namespace ml
+{
+template <class V, class C = std::less<Symbol> >
+class PersistentTree
+{
+ public:
+  class Node;
+  using NodePtr = std::shared_ptr<Node>;
+
+  class Node
+  {
+    friend class PersistentTree<V, C>;
+    V _value{};
+
+    // children, kept sorted by C.
+    std::vector<std::pair<Symbol, NodePtr> > _children;
+
+   public:
+    bool hasValue() const { return _value != V(); }
+    const V& getValue() const { return _value; }
+    bool isLeaf() const { return _children.empty(); }
+  };
+
+ private:
+  // the root node, or null if the tree is empty.
+  NodePtr _root;
+
+  template <class N>
+  static auto findChild(N& n, Symbol key)
+  {
+    return std::lower_bound(n._children.begin(), n._children.end(), key,
+                            [](const std::pair<Symbol, NodePtr>& a, Symbol b) { return C()(a.first, b); });
+  }
+
+  // make the node pointed to unique, copying it if it is shared with any other tree.
+  static Node& makeUnique(NodePtr& p)
+  {
+    if (p.use_count() > 1)
+    {
+      p = std::make_shared<Node>(*p);
+    }
+    return *p;
+  }
+
+  // get a node for writing, copying any shared nodes and adding any
+  // nodes that are not yet in the tree along the way.
+  Node& writableNode(Path path)
+  {
+    if (!_root)
+    {
+      _root = std::make_shared<Node>();
+    }
+    Node* pNode = &makeUnique(_root);
+    for (Symbol key : path)
+    {
+      auto it = findChild(*pNode, key);
+      if ((it == pNode->_children.end()) || (it->first != key))
+      {
+        it = pNode->_children.emplace(it, key, std::make_shared<Node>());
+      }
+      pNode = &makeUnique(it->second);
+    }
+    return *pNode;
+  }
+
+  static size_t countValues(const Node* pNode)
+  {
+    if (!pNode) return 0;
+    size_t sum = pNode->hasValue();
+    for (auto& child : pNode->_children)
+    {
+      sum += countValues(child.second.get());
+    }
+    return sum;
+  }
+
+  // visit the differing values of the two nodes and their children in
+  // depth-first order. A missing node has no values.
+  template <class F>
+  static void visitChanges(const Node* pA, const Node* pB, Path path, F& f)
+  {
+    if (pA == pB) return;
+    static const V nullValue{};
+    static const std::vector<std::pair<Symbol, NodePtr> > noChildren;
+    const V& valueA = pA ? pA->_value : nullValue;
+    const V& valueB = pB ? pB->_value : nullValue;
+    if (valueA != valueB)
+    {
+      f(path, valueA, valueB);
+    }
+
+    // merge the sorted children of the two nodes.
+    auto& childrenA = pA ? pA->_children : noChildren;
+    auto& childrenB = pB ? pB->_children : noChildren;
+    auto itA = childrenA.begin();
+    auto itB = childrenB.begin();
+    while ((itA != childrenA.end()) || (itB != childrenB.end()))
+    {
+      if ((itB == childrenB.end()) || ((itA != childrenA.end()) && C()(itA->first, itB->first)))
+      {
+        visitChanges(itA->second.get(), nullptr, Path{path, itA->first}, f);
+        ++itA;
+      }
+      else if ((itA == childrenA.end()) || C()(itB->first, itA->first))
+      {
+        visitChanges(nullptr, itB->second.get(), Path{path, itB->first}, f);
+        ++itB;
+      }
+      else
+      {
+        visitChanges(itA->second.get(), itB->second.get(), Path{path, itA->first}, f);
+        ++itA;
+        ++itB;
+      }
+    }
+  }
+
+ public:
+  PersistentTree() = default;
+
+  // make a PersistentTree with the values of a Tree.
+  explicit PersistentTree(const Tree<V, C>& t)
+  {
+    for (auto it = t.begin(); it != t.end(); ++it)
+    {
+      add(it.getCurrentPath(), *it);
+    }
+  }
+
+  // return a Tree with our values.
+  Tree<V, C> toTree() const
+  {
+    Tree<V, C> t;
+    for (auto it = begin(); it != end(); ++it)
+    {
+      t.add(it.getCurrentPath(), *it);
+    }
+    return t;
+  }
+
+  // copying is O(1). snapshot() just makes the intent clear.
+  PersistentTree snapshot() const { return *this; }
+
+  void clear() { _root.reset(); }
+
+  // return true if the trees share all their nodes.
+  bool isSameSnapshot(const PersistentTree& b) const { return _root == b._root; }
+
+  // find a tree node at the specified path.
+  // if successful, return a const pointer to the node. If unsuccessful, return nullptr.
+  const Node* getConstNode(Path path) const
+  {
+    const Node* pNode = _root.get();
+    for (Symbol key : path)
+    {
+      if (!pNode) break;
+      auto it = findChild(*pNode, key);
+      pNode = ((it != pNode->_children.end()) && (it->first == key)) ? it->second.get() : nullptr;
+    }
+    return pNode;
+  }
+
+  // if the path exists, returns a const reference to the value in the tree at
+  // the path. Otherwise, reference to a null valued object is returned.
+  const V& operator[](Path p) const
+  {
+    static const V nullValue{};
+    const Node* pNode = getConstNode(p);
+    return pNode ? pNode->_value : nullValue;
+  }
+
+  // returns a reference to the value in the tree at the path, adding a new
+  // default object if needed. Any nodes on the path shared with other trees
+  // are copied first, so the reference may be written to.
+  V& operator[](Path p) { return writableNode(p)._value; }
+
+  // write a value V to the tree such that getValue(path) will return V.
+  void add(Path path, V val) { writableNode(path)._value = std::move(val); }
+
+  // remove the node at the path, and all of its children. Erasing the empty
+  // path clears the tree.
+  void erase(Path p)
+  {
+    if (!p)
+    {
+      clear();
+      return;
+    }
+    if (!getConstNode(p)) return;
+    Node& parent = writableNode(butLast(p));
+    parent._children.erase(findChild(parent, last(p)));
+  }
+
+  // call f(path, oldValue, newValue) for each path at which the value in
+  // this tree differs from the value in the newer tree, in depth-first order.
+  template <class F>
+  void forEachChange(const PersistentTree& newer, F f) const
+  {
+    visitChanges(_root.get(), newer._root.get(), Path(), f);
+  }
+
+  // compare two PersistentTrees by value.
+  bool operator==(const PersistentTree& b) const
+  {
+    bool equal{true};
+    forEachChange(b, [&](Path, const V&, const V&) { equal = false; });
+    return equal;
+  }
+
+  bool operator!=(const PersistentTree& b) const { return !(operator==(b)); }
+
+  // count the nodes with values.
+  size_t size() const { return countValues(_root.get()); }
+
+  // NOTE as with Tree, this iterator only supports simple begin(), end()
+  // loops and range-based for. Use the pre-increment form ++it.
+  // The tree must not be modified while iterating.
+
+  class const_iterator
+  {
+    friend class PersistentTree<V, C>;
+
+    // for each level from the root down, the parent node and the index of the
+    // current child. An index equal to the number of children means the end.
+    struct Level
+    {
+      const Node* parent{nullptr};
+      size_t index{0};
+    };
+    std::array<Level, kPathMaxSymbols + 1> _stack{};
+    size_t _top{0};
+
+    const_iterator(const Node* pRoot, size_t index) { _stack[0] = Level{pRoot, index}; }
+
+    const Node* currentNode() const
+    {
+      const Level& l = _stack[_top];
+      return (l.parent && (l.index < l.parent->_children.size())) ? l.parent->_children[l.index].second.get()
+                                                                  : nullptr;
+    }
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = const V;
+    using difference_type = int;
+    using pointer = const V*;
+    using reference = const V&;
+
+    const_iterator() = default;
+
+    bool operator==(const const_iterator& b) const
+    {
+      return (_top == b._top) && (_stack[_top].parent == b._stack[_top].parent) &&
+             (_stack[_top].index == b._stack[_top].index);
+    }
+
+    bool operator!=(const const_iterator& b) const { return !(*this == b); }
+
+    const V& operator*() const { return currentNode()->_value; }
+
+    bool currentNodeHasValue() const
+    {
+      const Node* pNode = currentNode();
+      return pNode && pNode->hasValue();
+    }
+
+    // advance to the next node depth-first. Return false if at end of entire tree.
+    bool nextNode()
+    {
+      if (const Node* pNode = currentNode())
+      {
+        if (!pNode->isLeaf() && (_top < kPathMaxSymbols))
+        {
+          _stack[++_top] = Level{pNode, 0};
+        }
+        else
+        {
+          _stack[_top].index++;
+        }
+      }
+      else
+      {
+        if (_top == 0) return false;
+        _stack[--_top].index++;
+      }
+      return true;
+    }
+
+    // advance to the next node that has a value
+    const const_iterator& operator++()
+    {
+      while (nextNode())
+      {
+        if (currentNodeHasValue()) break;
+      }
+      return *this;
+    }
+
+    size_t getCurrentDepth() const { return _top; }
+
+    // return the last symbol of the current node path.
+    Symbol getCurrentNodeName() const
+    {
+      return currentNode() ? _stack[_top].parent->_children[_stack[_top].index].first : Symbol();
+    }
+
+    // return the entire path to the current node.
+    Path getCurrentPath() const
+    {
+      Path p;
+      for (size_t i = 0; i <= _top; ++i)
+      {
+        const Level& l = _stack[i];
+        if (l.index < l.parent->_children.size())
+        {
+          p = Path{p, l.parent->_children[l.index].first};
+        }
+      }
+      return p;
+    }
+  };
+
+  // start at beginning, then advance until a node with a value is reached.
+  const_iterator begin() const
+  {
+    auto it = const_iterator(_root.get(), 0);
+    if (_root && !_root->isLeaf() && !it.currentNodeHasValue())
+    {
+      ++it;
+    }
+    return it;
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(_root.get(), _root ? _root->_children.size() : 0);
+  }
+
+  // visit all nodes and dump only the nodes with values.
+  void dump() const
+  {
+    for (auto it = begin(); it != end(); ++it)
+    {
+      std::cout << it.getCurrentPath() << " [" << *it << "] \n";
+    }
+  }
+};
+
+// return the changes that would turn the tree before into the tree after.
+inline std::vector<ValueChange> getChanges(const PersistentTree<Value>& before,
+                                           const PersistentTree<Value>& after)
+{
+  std::vector<ValueChange> changes;
+  before.forEachChange(after, [&](Path p, const Value& oldValue, const Value& newValue) {
+    changes.emplace_back(p, newValue, oldValue);
+  });
+  return changes;
+}
+
+}  // namespace ml
@@ -4,20 +4,24 @@
 
 #pragma once
 
+#include "MLPersistentTree.h"
 #include "MLSerialization.h"
 #include "MLTree.h"
 #include "MLValue.h"
 
 namespace ml
 {
+// PropertyTree stores its Values in a PersistentTree, so copies of a
+// PropertyTree are cheap and share their unchanged properties.
 class PropertyTree
 {
-  Tree<Value> properties;
+  PersistentTree<Value> properties;
 
  public:
   PropertyTree() = default;
   PropertyTree(Tree<Value> vt) : properties(vt) {}
-  PropertyTree(const PropertyTree& other) : properties(other.properties) {}
+  PropertyTree(const PropertyTree& other) = default;
+  PropertyTree& operator=(const PropertyTree& other) = default;
   PropertyTree(const std::initializer_list<NamedValue> p)
   {
     for (const auto& v : p)
@@ -66,7 +70,7 @@ class PropertyTree
     return properties[p].getUnsignedLongValueWithDefault(d);
   }
 
-  std::vector<unsigned char> propertyTreeToBinary() { return valueTreeToBinary(properties); }
+  std::vector<unsigned char> propertyTreeToBinary() { return valueTreeToBinary(properties.toTree()); }
   PropertyTree binaryToPropertyTree(const std::vector<unsigned char>& binaryData)
   {
     return PropertyTree(binaryToValueTree(binaryData));
@@ -82,9 +86,15 @@ class PropertyTree
 
   void dump() { properties.dump(); }
 
-  inline Tree<Value>::const_iterator begin() const { return properties.begin(); }
+  // return the changes that would turn this PropertyTree into the other.
+  std::vector<ValueChange> getChangesTo(const PropertyTree& other) const
+  {
+    return getChanges(properties, other.properties);
+  }
+
+  inline PersistentTree<Value>::const_iterator begin() const { return properties.begin(); }
 
-  inline Tree<Value>::const_iterator end() const { return properties.end(); }
+  inline PersistentTree<Value>::const_iterator end() const { return properties.end(); }
 };
 
 }  // namespace ml
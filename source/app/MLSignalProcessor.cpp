@@ -4,6 +4,11 @@
 
 #include "MLSignalProcessor.h"
 
+#if ML_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 using namespace ml;
 
 // SignalProcessor::PublishedSignal
@@ -38,6 +43,35 @@ size_t SignalProcessor::PublishedSignal::read(float* pDest, size_t framesRequest
 
 // SignalProcessor::ProcessTime
 
+namespace
+{
+// make the ramp start + step*i over one vector. If wrap is set, values above 1 are
+// wrapped back into (0, 1] as the sample-by-sample phasor did.
+DSPVector phasorRamp(double start, double step, bool wrap)
+{
+  DSPVector y{columnIndex() * DSPVector((float)step) + DSPVector((float)start)};
+  if (wrap)
+  {
+    float* py = y.getBuffer();
+    const SIMDVectorFloat vOne = vecSet1(1.f);
+    for (int n = 0; n < kSIMDVectorsPerDSPVector; ++n)
+    {
+      // p - ceil(p - 1) for p > 1. p - 1 is positive there, so its ceil is
+      // its truncation plus one if it has a fractional part.
+      SIMDVectorFloat p = vecLoad(py);
+      SIMDVectorFloat x = vecSub(p, vOne);
+      SIMDVectorFloat t = vecIntPart(x);
+      SIMDVectorFloat c = vecAdd(t, vecAnd(vOne, vecGreaterThan(x, t)));
+      vecStore(py, vecSelect(vecSub(p, c), p, vecGreaterThan(p, vOne)));
+      py += kFloatsPerSIMDVector;
+    }
+  }
+  return y;
+}
+
+inline double wrapPhase(double p) { return (p > 1.) ? p - std::ceil(p - 1.) : p; }
+}  // namespace
+
 // Set the time and bpm. The time refers to the start of the current engine processing block.
 void SignalProcessor::ProcessTime::setTimeAndRate(const double secs, const double ppqPos,
                                                   const double bpm, bool isPlaying,
@@ -92,6 +126,7 @@ void SignalProcessor::ProcessTime::setTimeAndRate(const double secs, const doubl
 
     _secondsCounter = secs;
     _secondsPhaseCounter = fmodl(secs, 1.0);
+    _quarterNotes = ppqPos - ppqPhase + _omega;
   }
   else
   {
@@ -100,6 +135,7 @@ void SignalProcessor::ProcessTime::setTimeAndRate(const double secs, const doubl
     _secondsCounter = -1.;
     _dsdt = 0.;
     _secondsPhaseCounter = -1.;
+    _quarterNotes = -1.;
   }
 
   _ppqPos1 = ppqPos;
@@ -120,22 +156,206 @@ void SignalProcessor::ProcessTime::clear(void)
 // generate phasors from the input parameters
 void SignalProcessor::ProcessTime::process()
 {
-  auto _fomega = (double)_omega;
-  for (int n = 0; n < kFloatsPerDSPVector; ++n)
+  _quarterNotesPhase = phasorRamp(_omega, _dpdt, true);
+  _seconds = phasorRamp(_secondsCounter, _dsdt, false);
+  _secondsPhase = phasorRamp(_secondsPhaseCounter, _dsdt, true);
+
+  // advance the counters in double so the start of each vector stays exact.
+  constexpr double kVectorSize = kFloatsPerDSPVector;
+  _omega = wrapPhase(_omega + _dpdt * kVectorSize);
+  _secondsCounter += _dsdt * kVectorSize;
+  _secondsPhaseCounter = wrapPhase(_secondsPhaseCounter + _dsdt * kVectorSize);
+  _vectorQuarterNotes = _quarterNotes;
+  _quarterNotes += _dpdt * kVectorSize;
+  _samplesSincePreviousTime += kFloatsPerDSPVector;
+}
+
+DSPVector SignalProcessor::ProcessTime::getPhasorAtRatio(double ratio) const
+{
+  if (!_active1) return DSPVector(-1.f);
+  double p = _vectorQuarterNotes * ratio;
+  return phasorRamp(p - std::floor(p), _dpdt * ratio, true);
+}
+
+// SignalProcessor::WorkerPool
+
+namespace
+{
+// workers spin for about this many pause instructions before sleeping.
+constexpr int kWorkerSpinPauses{1 << 14};
+constexpr int kMaxPausesPerCheck{64};
+
+inline uint64_t makeJob(uint64_t generation, uint64_t nTasks, uint64_t nextTask)
+{
+  return (generation << 32) | (nTasks << 16) | nextTask;
+}
+inline uint32_t jobGeneration(uint64_t job) { return job >> 32; }
+inline size_t jobTasks(uint64_t job) { return (job >> 16) & 0xFFFF; }
+inline size_t jobNextTask(uint64_t job) { return job & 0xFFFF; }
+
+// a hint to the CPU that we are spinning. Unlike yielding to the scheduler,
+// this never gives the core to another thread.
+inline void cpuPause()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+  _mm_pause();
+#elif (defined(__aarch64__) || defined(__arm__)) && defined(__GNUC__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+#if ML_LINUX
+void pinThreadToCore(pthread_t t, int core)
+{
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(core, &cpus);
+  pthread_setaffinity_np(t, sizeof(cpu_set_t), &cpus);
+}
+#endif
+}  // namespace
+
+void SignalProcessor::WorkerPool::start(size_t nThreads)
+{
+  stop();
+  _running = true;
+  _threadsConfigured = false;
+  for (size_t i = 0; i < nThreads; ++i)
+  {
+    _threads.emplace_back(&WorkerPool::workerLoop, this);
+  }
+}
+
+// pin the calling thread to its current core and the workers to the other
+// cores in turn. If the calling thread has a real-time policy, give the
+// workers the same policy one step below its priority. Any of this may fail
+// without the right permissions, in which case the threads just run normally.
+void SignalProcessor::WorkerPool::configureThreads()
+{
+  _threadsConfigured = true;
+#if ML_LINUX
+  int nCores = static_cast<int>(std::thread::hardware_concurrency());
+  int callerCore = sched_getcpu();
+  if ((nCores > 1) && (callerCore >= 0))
   {
-    _quarterNotesPhase[n] = (float)_fomega;
-    _fomega += _dpdt;
-    if (_fomega > 1.f)
+    pinThreadToCore(pthread_self(), callerCore);
+    for (size_t i = 0; i < _threads.size(); ++i)
     {
-      _fomega -= 1.f;
+      int otherCore = static_cast<int>(i % (nCores - 1));
+      pinThreadToCore(_threads[i].native_handle(), otherCore + (otherCore >= callerCore));
     }
   }
-  for (int n = 0; n < kFloatsPerDSPVector; ++n)
+
+  int policy;
+  sched_param callerParam;
+  if ((pthread_getschedparam(pthread_self(), &policy, &callerParam) == 0) &&
+      ((policy == SCHED_FIFO) || (policy == SCHED_RR)))
   {
-    _seconds[n] = (float)_secondsCounter;
-    _secondsCounter += _dsdt;
-    _secondsPhase[n] = (float)_secondsPhaseCounter;
-    _secondsPhaseCounter += _dsdt;
+    sched_param workerParam;
+    workerParam.sched_priority =
+        std::max(callerParam.sched_priority - 1, sched_get_priority_min(policy));
+    for (auto& t : _threads)
+    {
+      pthread_setschedparam(t.native_handle(), policy, &workerParam);
+    }
+  }
+#endif
+}
+
+void SignalProcessor::WorkerPool::stop()
+{
+  if (_threads.empty()) return;
+  {
+    std::unique_lock<std::mutex> lock(_sleepMutex);
+    _running = false;
+  }
+  _wakeCondition.notify_all();
+  for (auto& t : _threads)
+  {
+    t.join();
+  }
+  _threads.clear();
+}
+
+// claim the next task of the current job if there is one, and run it.
+bool SignalProcessor::WorkerPool::claimAndRunTask()
+{
+  uint64_t job = _job.load();
+  while (jobNextTask(job) < jobTasks(job))
+  {
+    TaskFn fn = _fn.load();
+    void* context = _context.load();
+    if (_job.compare_exchange_weak(job, job + 1))
+    {
+      // the job can't finish before this task does, so fn and context are current.
+      fn(context, jobNextTask(job));
+      _tasksDone++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void SignalProcessor::WorkerPool::run(size_t nTasks, TaskFn fn, void* context)
+{
+  if (!_threadsConfigured)
+  {
+    configureThreads();
+  }
+
+  uint32_t nextGeneration = jobGeneration(_job.load()) + 1;
+  _fn = fn;
+  _context = context;
+  _tasksDone = 0;
+  _job = makeJob(nextGeneration, nTasks, 0);
+
+  // wake any sleeping workers
+  if (_sleepers.load() > 0)
+  {
+    {
+      std::unique_lock<std::mutex> lock(_sleepMutex);
+    }
+    _wakeCondition.notify_all();
+  }
+
+  while (claimAndRunTask())
+  {
+  }
+
+  // wait for workers to finish their last tasks
+  while (_tasksDone.load() < nTasks)
+  {
+  }
+}
+
+void SignalProcessor::WorkerPool::workerLoop()
+{
+  uint32_t seenGeneration = jobGeneration(_job.load());
+  while (_running)
+  {
+    // spin for a while waiting for a new job, checking less often as time
+    // goes on, then sleep.
+    int pauses = 0;
+    int pausesPerCheck = 1;
+    while ((jobGeneration(_job.load()) == seenGeneration) && (pauses < kWorkerSpinPauses))
+    {
+      for (int i = 0; i < pausesPerCheck; ++i) cpuPause();
+      pauses += pausesPerCheck;
+      pausesPerCheck = std::min(pausesPerCheck * 2, kMaxPausesPerCheck);
+    }
+    if (jobGeneration(_job.load()) == seenGeneration)
+    {
+      std::unique_lock<std::mutex> lock(_sleepMutex);
+      _sleepers++;
+      _wakeCondition.wait(lock, [&]() {
+        return !_running || (jobGeneration(_job.load()) != seenGeneration);
+      });
+      _sleepers--;
+    }
+
+    seenGeneration = jobGeneration(_job.load());
+    while (claimAndRunTask())
+    {
+    }
   }
-  _samplesSincePreviousTime += kFloatsPerDSPVector;
 }
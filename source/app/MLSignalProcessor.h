@@ -4,6 +4,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "MLActor.h"
 #include "MLDSPUtils.h"
 #include "MLParameters.h"
@@ -121,9 +126,16 @@ class SignalProcessor
     // clear state
     void clear();
 
-    // generate phasors from the input parameters
+    // generate phasors from the input parameters. Each vector's start values are
+    // counted in double precision and the ramps within the vector are made in float.
     void process();
 
+    // get a phasor for the current vector running at the given ratio to quarter
+    // notes, for example 0.25 for one cycle per four quarter notes. Its phase is
+    // taken from the host position, so it stays locked to the beat without a PLL.
+    // returns -1 when the host is not playing, like the other signals.
+    DSPVector getPhasorAtRatio(double ratio) const;
+
     // signals containing time from score start
     DSPVector _quarterNotesPhase;
     DSPVector _seconds;
@@ -141,6 +153,80 @@ class SignalProcessor
     double _ppqPhase1{0};
     double _secondsCounter{0};
     double _secondsPhaseCounter{0};
+
+    // position in quarter notes at the start of the next vector and the current one.
+    double _quarterNotes{-1};
+    double _vectorQuarterNotes{-1};
+  };
+
+  // SignalProcessor::WorkerPool runs independent tasks, like rendering voices, on
+  // other cores within one processVector() call. The calling thread takes tasks
+  // too, and returns when all are done. On the first call, where the platform
+  // allows, the calling thread is pinned to the core it is running on, and the
+  // workers are pinned to the other cores and given a real-time priority just
+  // below that of the calling thread, so they can never preempt it. Between
+  // calls, workers spin with a pause hint for a short time and then sleep. With
+  // no workers, or fewer tasks than the minimum set, tasks simply run serially
+  // on the calling thread.
+
+  class WorkerPool
+  {
+   public:
+    using TaskFn = void (*)(void* context, size_t task);
+
+    WorkerPool() = default;
+    ~WorkerPool() { stop(); }
+
+    // start or stop the worker threads. Don't call these while processing.
+    void start(size_t nThreads);
+    void stop();
+
+    size_t getNumThreads() const { return _threads.size(); }
+
+    // set the fewest tasks that are worth waking workers for.
+    void setMinParallelTasks(size_t n) { _minParallelTasks = n; }
+
+    // call fn(i) for each i in [0, nTasks) and return when all calls are done.
+    template <typename Fn>
+    void parallelFor(size_t nTasks, Fn&& fn)
+    {
+      if (_threads.empty() || (nTasks < _minParallelTasks) || (nTasks > kMaxTasks))
+      {
+        for (size_t i = 0; i < nTasks; ++i) fn(i);
+      }
+      else
+      {
+        using FnType = typename std::remove_reference<Fn>::type;
+        run(nTasks, [](void* context, size_t i) { (*static_cast<FnType*>(context))(i); },
+            const_cast<void*>(static_cast<const void*>(&fn)));
+      }
+    }
+
+   private:
+    static constexpr size_t kMaxTasks{0xFFFF};
+
+    void run(size_t nTasks, TaskFn fn, void* context);
+    void workerLoop();
+    bool claimAndRunTask();
+
+    // set core affinities and priorities from the calling thread.
+    void configureThreads();
+
+    std::vector<std::thread> _threads;
+    bool _threadsConfigured{false};
+    size_t _minParallelTasks{2};
+
+    // the current job: generation in the top 32 bits, number of tasks in the
+    // next 16, and the next task to claim in the low 16.
+    std::atomic<uint64_t> _job{0};
+    std::atomic<TaskFn> _fn{nullptr};
+    std::atomic<void*> _context{nullptr};
+    std::atomic<size_t> _tasksDone{0};
+
+    std::atomic<bool> _running{false};
+    std::atomic<int> _sleepers{0};
+    std::mutex _sleepMutex;
+    std::condition_variable _wakeCondition;
   };
 
   // class used for assigning each instance of our SignalProcessor a unique ID
@@ -167,21 +253,101 @@ class SignalProcessor
 
   virtual void processVector(MainInputs inputs, MainOutputs outputs, void* stateData = nullptr) {}
 
+  // opt in to rendering voices on other cores with renderVoices(). With 0
+  // threads, which is the default, all voices render on the audio thread.
+  void setNumWorkerThreads(size_t n)
+  {
+    _workers.stop();
+    if(n > 0) _workers.start(n);
+  }
 
+
+  // set a parameter from any control thread. The new value is published to the
+  // audio thread through _paramSnapshot.
   void setParamFromNormalizedValue(Path pname, float val)
   {
+    std::unique_lock<std::mutex> lock(_paramWriteMutex);
+    _params.setFromNormalizedValue(pname, val);
+    size_t id = getParamID(pname);
+    if(id != kNoParamID)
+    {
+      _paramSnapshot.setValue(id, _params.getRealFloatValue(pname), _params.getNormalizedFloatValue(pname));
+      _paramSnapshot.publish();
+    }
+  }
+
+  // set a parameter by handle, skipping the name lookup.
+  void setParamFromNormalizedValue(ParamHandle h, float val)
+  {
+    std::unique_lock<std::mutex> lock(_paramWriteMutex);
+    if(h.id >= _paramNamesByID.size()) return;
+    const Path& pname = _paramNamesByID[h.id];
     _params.setFromNormalizedValue(pname, val);
+    _paramSnapshot.setValue(h.id, _params.getRealFloatValue(pname), val);
+    _paramSnapshot.publish();
   }
 
+  // build the parameter tree and give each parameter an ID, in list order.
   inline void buildParams(const ParameterDescriptionList& paramList)
   {
+    std::unique_lock<std::mutex> lock(_paramWriteMutex);
     buildParameterTree(paramList, _params);
+    _paramNamesByID.clear();
+    for (const auto& paramDesc : paramList)
+    {
+      _paramNamesByID.push_back(Path(paramDesc->getTextProperty("name")));
+    }
+
+    // index the IDs by hash(Path), keeping the table at most half full.
+    size_t tableSize = 16;
+    while(tableSize < _paramNamesByID.size() * 2) tableSize *= 2;
+    _paramIDsByHash.assign(tableSize, kNoParamID);
+    for(size_t id = 0; id < _paramNamesByID.size(); ++id)
+    {
+      size_t i = hash(_paramNamesByID[id]) & (tableSize - 1);
+      while(_paramIDsByHash[i] != kNoParamID) i = (i + 1) & (tableSize - 1);
+      _paramIDsByHash[i] = id;
+    }
+    _paramSnapshot.resize(_paramNamesByID.size());
   };
   
   inline void setDefaultParams()
   {
+    std::unique_lock<std::mutex> lock(_paramWriteMutex);
     setDefaults(_params);
+    for(size_t id = 0; id < _paramNamesByID.size(); ++id)
+    {
+      const Path& pname = _paramNamesByID[id];
+      _paramSnapshot.setValue(id, _params.getRealFloatValue(pname), _params.getNormalizedFloatValue(pname));
+    }
+    _paramSnapshot.publish();
   };
+
+  static constexpr size_t kNoParamID{ParamHandle::kNoID};
+
+  // get the ID of a parameter, or kNoParamID if there is no parameter with the name.
+  // This hashes the name and probes a flat table, so it is safe on the audio thread.
+  size_t getParamID(Path pname) const
+  {
+    if(_paramIDsByHash.empty()) return kNoParamID;
+    const size_t mask = _paramIDsByHash.size() - 1;
+    for(size_t i = hash(pname) & mask; ; i = (i + 1) & mask)
+    {
+      size_t id = _paramIDsByHash[i];
+      if((id == kNoParamID) || (_paramNamesByID[id] == pname)) return id;
+    }
+  }
+
+  // resolve a parameter name to a handle. Call this after buildParams(), not
+  // while processing. The handle is false if there is no parameter with the name.
+  ParamHandle getParamHandle(Path pname) const { return ParamHandle{getParamID(pname)}; }
+
+  Path getParamName(ParamHandle h) const
+  {
+    return (h.id < _paramNamesByID.size()) ? _paramNamesByID[h.id] : Path();
+  }
+
+  size_t getNumParams() const { return _paramNamesByID.size(); }
   
 
  protected:
@@ -201,23 +367,73 @@ class SignalProcessor
   // buffer object to call processVector() from process() calls of arbitrary frame sizes
   VectorProcessBuffer processBuffer;
 
-  std::vector<ml::Path> _paramNamesByID;  // needed?
-  Tree<size_t> _paramIDsByName;
+  // parameter IDs are assigned in buildParams() and don't change after that.
+  std::vector<ml::Path> _paramNamesByID;
+
+  // open-addressed table of parameter IDs, probed linearly from hash(Path),
+  // with kNoParamID marking an empty slot.
+  std::vector<size_t> _paramIDsByHash;
+
+  // control threads write parameters here, and processVector() reads them.
+  ParameterSnapshot _paramSnapshot;
+  std::mutex _paramWriteMutex;
 
   // single buffer for reading from signals
   std::vector<float> _readBuffer;
 
-  // param access
+  // param access for the audio thread. These read the latest published
+  // snapshot and never lock or allocate. Looking up by name costs a hash of the
+  // Path; use a ParamHandle to skip it.
   inline float getRealFloatParam(Path pname)
   {
-    return _params.getRealFloatValue(pname);
+    size_t id = getParamID(pname);
+    return (id != kNoParamID) ? _paramSnapshot.read().real[id] : 0.f;
   }
   
   inline float getNormalizedFloatParam(Path pname)
   {
-    return _params.getNormalizedFloatValue(pname);
+    size_t id = getParamID(pname);
+    return (id != kNoParamID) ? _paramSnapshot.read().normalized[id] : 0.f;
+  }
+
+  // param access by handle in constant time, also lock-free.
+  inline float getRealFloatParam(ParamHandle h)
+  {
+    auto& values = _paramSnapshot.read();
+    return (h.id < values.real.size()) ? values.real[h.id] : 0.f;
+  }
+
+  inline float getNormalizedFloatParam(ParamHandle h)
+  {
+    auto& values = _paramSnapshot.read();
+    return (h.id < values.normalized.size()) ? values.normalized[h.id] : 0.f;
+  }
+
+  // get all of the latest parameter values at once, indexed by ID. Use this
+  // when several values must come from the same snapshot.
+  inline const ParameterSnapshot::Values& getParamSnapshot()
+  {
+    return _paramSnapshot.read();
   }
   
+  // call voiceFn(v) for each voice v in [0, nVoices), using the worker pool if
+  // enabled, and return the sum of the outputs. Each voice's output is stored in
+  // pVoiceOutputs[v], and the sum is taken in voice order so the result doesn't
+  // depend on which thread rendered each voice.
+  template <size_t ROWS, typename Fn>
+  inline DSPVectorArray<ROWS> renderVoices(size_t nVoices, DSPVectorArray<ROWS>* pVoiceOutputs, Fn&& voiceFn)
+  {
+    _workers.parallelFor(nVoices, [&](size_t v) { pVoiceOutputs[v] = voiceFn(v); });
+    DSPVectorArray<ROWS> sum;
+    for(size_t v = 0; v < nVoices; ++v)
+    {
+      sum += pVoiceOutputs[v];
+    }
+    return sum;
+  }
+
+  WorkerPool _workers;
+
   Tree<std::unique_ptr<PublishedSignal> > _publishedSignals;
 
   inline void publishSignal(Path signalName, int maxFrames, int maxVoices, int channels, int octavesDown)
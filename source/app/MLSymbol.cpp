@@ -8,80 +8,36 @@ namespace ml
 {
 #pragma mark SymbolTable
 
-SymbolTable::SymbolTable() { clear(); }
+SymbolTable::SymbolTable() : mEntries(kDefaultSymbolTableSize, kDefaultHashTableBits) { clear(); }
 
-SymbolTable::~SymbolTable()
-{
-  // TODO better protection on delete
-  // can this be avoided with more explicit setup / shutdown
-  // (RAII in main() )
-  // std::unique_lock<std::mutex> lock(mMutex);
-}
+SymbolTable::~SymbolTable() = default;
 
-// clear all symbols from the table.
+// clear all symbols from the table. Allocated chunks are kept for reuse.
 void SymbolTable::clear()
 {
-  mSize = 0;
-  // std::unique_lock<std::mutex> lock(mMutex);
+  // ID 0 is the null symbol, with empty text.
+  mEntries.clear(fnv1aHash("", 0), [](Entry& e) { e.text = TextFragment(); });
 
-  mSymbolTextsByID.clear();
-  mSymbolTextsByID.reserve(kDefaultSymbolTableSize);
-
-  for (int i = 0; i < kHashTableSize; ++i)
+  std::unique_lock<std::mutex> lock(mEntries.getAddMutex());
+  for (auto& c : mLiteralCache)
   {
-    clearEntry(mHashTable[i]);
+    c.pChars.store(nullptr, std::memory_order_relaxed);
+    c.id.store(0, std::memory_order_relaxed);
   }
-
-  // add null entry - why?
-  addEntry(HashedCharArray());
-}
-
-// add an entry to the table. The entry must not already exist in the table.
-// this must be the only way of modifying the symbol table.
-SymbolID SymbolTable::addEntry(const HashedCharArray& hsl)
-{
-  mSymbolTextsByID.emplace_back(TextFragment(hsl.pChars, static_cast<int>(hsl.len)));
-
-  size_t newID = mSize++;
-  mHashTable[hsl.hash].mIDVector.emplace_back(newID);
-  return newID;
 }
 
 SymbolID SymbolTable::getSymbolID(const HashedCharArray& hsl)
 {
-  SymbolID r = 0;
-
-  // get the vector of symbol IDs matching this hash. It probably has one entry
-  // but may have more.
-  const std::vector<SymbolID>& bin = mHashTable[hsl.hash].mIDVector;
-  {
-    bool found = false;
-
-    std::unique_lock<std::mutex> lock(mHashTable[hsl.hash].mMutex);
-
-    for (auto ID : bin)
-    {
-      // there should be few collisions, so probably the first ID in the hash
-      // bin will be the symbol we are looking for. Unfortunately to test for
-      // equality we may have to compare the entire string.
-      TextFragment* binFragment = &mSymbolTextsByID[ID];
-      if (compareSizedCharArrays(binFragment->getText(), binFragment->lengthInBytes(), hsl.pChars,
-                                 hsl.len))
-      {
-        r = ID;
-        found = true;
-        break;
-      }
-    }
-
-    if (!found)
-    {
-      mSymbolTextsByID.emplace_back(TextFragment(hsl.pChars, static_cast<int>(hsl.len)));
-      r = mSize++;
-      mHashTable[hsl.hash].mIDVector.emplace_back(r);
-    }
-  }
-  return r;
+  if (!hsl.len) return 0;
+
+  // compare the stored hashes first, so that the text is compared only for
+  // the symbol we are looking for, or a full 64-bit collision.
+  auto match = [&hsl](const Entry& e) {
+    return compareSizedCharArrays(e.text.getText(), e.text.lengthInBytes(), hsl.pChars, hsl.len);
+  };
+  auto init = [&hsl](Entry& e) { e.text = TextFragment(hsl.pChars, hsl.len); };
+  SymbolID r = mEntries.find(hsl.hash, match);
+  return r ? r : mEntries.add(hsl.hash, match, init);
 }
 
 SymbolID SymbolTable::getSymbolID(const char* sym) { return getSymbolID(HashedCharArray(sym)); }
@@ -91,40 +47,42 @@ SymbolID SymbolTable::getSymbolID(const char* sym, size_t lengthBytes)
   return getSymbolID(HashedCharArray(sym, lengthBytes));
 }
 
-const TextFragment& SymbolTable::getSymbolTextByID(SymbolID symID)
+// look up a literal that was not in the cache, and try to cache it.
+SymbolID SymbolTable::cacheLiteral(const HashedCharArray& hsl)
 {
-  return mSymbolTextsByID[symID];
+  SymbolID id = getSymbolID(hsl);
+
+  // if another thread is adding symbols, skip caching this time.
+  std::unique_lock<std::mutex> lock(mEntries.getAddMutex(), std::try_to_lock);
+  if (lock.owns_lock())
+  {
+    LiteralCacheEntry& c = mLiteralCache[literalCacheIndex(hsl.pChars)];
+    c.pChars.store(nullptr, std::memory_order_relaxed);
+    c.id.store(id, std::memory_order_release);
+    c.pChars.store(hsl.pChars, std::memory_order_release);
+  }
+  return id;
 }
 
+const TextFragment& SymbolTable::getSymbolTextByID(SymbolID symID) { return getEntry(symID).text; }
+
 void SymbolTable::dump()
 {
+  size_t size = getSize();
   std::cout << "---------------------------------------------------------\n";
-  std::cout << mSymbolTextsByID.size() << " symbols:\n";
+  std::cout << size << " symbols:\n";
 
   // print symbols in order of creation.
-  for (int i = 0; i < mSymbolTextsByID.size(); ++i)
+  for (int i = 0; i < size; ++i)
   {
-    const TextFragment& sym = mSymbolTextsByID[i];
+    const TextFragment& sym = getSymbolTextByID(i);
     std::cout << "    ID " << i << " = " << sym << "\n";
   }
   // print nonzero entries in hash table
-  int hash = 0;
-  for (auto& tableEntry : mHashTable)
-  {
-    auto idVec = tableEntry.mIDVector;
-    size_t idVecLen = idVec.size();
-    if (idVecLen > 0)
-    {
-      std::cout << "#" << hash << " ";
-      for (auto id : idVec)
-      {
-        std::cout << id << " " << getSymbolTextByID(id) << " ";
-      }
-
-      std::cout << "\n";
-    }
-    hash++;
-  }
+  mEntries.forEachSlot([this](size_t i, SymbolID id) {
+    std::cout << "#" << i << " " << id << " " << getSymbolTextByID(id) << " (" << std::hex
+              << getEntry(id).hash << std::dec << ")\n";
+  });
 }
 
 int SymbolTable::audit()
@@ -132,7 +90,7 @@ int SymbolTable::audit()
   int i = 0;
   SymbolID i2{0};
   bool OK = true;
-  size_t size = mSymbolTextsByID.size();
+  size_t size = getSize();
 
   for (i = 0; i < size; ++i)
   {
@@ -28,67 +28,71 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <type_traits>
 #include <vector>
 
+#include "MLInternTable.h"
 #include "MLText.h"
 
 namespace ml
 {
-constexpr int kHashTableBits = 12;
-constexpr int kHashTableSize = (1 << kHashTableBits);
-constexpr int kHashTableMask = kHashTableSize - 1;
-
-// initial capacity of symbol table. if this number of symbols is exceeded, the
-// capacity of the table will have to be increased, which may result in a glitch
-// if called from the audio thread.
+// the hash table of symbol IDs starts with this many bits, enough for
+// kDefaultSymbolTableSize symbols. It grows as needed.
+constexpr int kDefaultHashTableBits = 13;
+
+// symbol texts are stored in chunks of this many entries, up to
+// kMaxSymbolChunks chunks. See InternTable.
+constexpr int kSymbolChunkBits = 10;
+constexpr int kMaxSymbolChunks = (1 << 12);
+
+// initial capacity of symbol table. Past this number of symbols, new chunks
+// will have to be allocated, which may result in a glitch if called from the
+// audio thread.
 // TODO these constants that tune different parts of madronalib for space use
 // etc. should all be in one header.
 constexpr int kDefaultSymbolTableSize = 4096;
 
-// very simple hash function from Kernighan & Ritchie.
-// Constexpr version for hashing strings known at compile time.
-template <size_t N>
-constexpr uint32_t krHash2(const char* str)
-{
-  return (N > 1) ? ((krHash2<N - 1>(str + 1)) + *str) * 31u : 0;
-}
+// number of entries in the cache of Symbols made from string literals.
+constexpr int kLiteralCacheBits = 10;
+constexpr int kLiteralCacheSize = (1 << kLiteralCacheBits);
 
-template <>
-constexpr uint32_t krHash2<size_t(0)>(const char* str)
-{
-  return 0;
-}
+// 64-bit FNV-1a hash. The same function hashes strings known at compile time
+// and at runtime, so their results can be compared.
+constexpr uint64_t kFNVOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFNVPrime = 1099511628211ull;
 
-template <size_t N>
-constexpr uint32_t krHash1(const char* str)
-{
-  return krHash2<N>(str) & kHashTableMask;
-}
-
-// non-recursive hash producing equivalent results to krHash1.
-// Non-constexpr version for hashing strings known only at runtime.
-inline uint32_t krHash0(const char* str, const size_t len)
+constexpr uint64_t fnv1aHash(const char* str, const size_t len)
 {
-  size_t i = len;
-  uint32_t accum = 0;
-  while (i > 0)
+  uint64_t accum = kFNVOffsetBasis;
+  for (size_t i = 0; i < len; ++i)
   {
-    i--;
-    accum += str[i];
-    accum *= 31u;
+    accum ^= static_cast<uint8_t>(str[i]);
+    accum *= kFNVPrime;
   }
-  return accum & kHashTableMask;
+  return accum;
 }
 
-inline uint32_t krHash0(const char* str) { return krHash0(str, strlen(str)); }
+inline uint64_t fnv1aHash(const char* str) { return fnv1aHash(str, strlen(str)); }
 
+// the length of the text in a char array, not including any null terminator.
 template <size_t N>
-constexpr uint32_t hash(const char (&sym)[N])
+constexpr size_t charArrayLength(const char (&sym)[N])
 {
-  return krHash1<N>(sym);
+  size_t i = 0;
+  while ((i < N) && sym[i]) ++i;
+  return i;
+}
+
+// hash a string literal, not including its null terminator.
+template <size_t N>
+constexpr uint64_t hash(const char (&sym)[N])
+{
+  return fnv1aHash(sym, N - 1);
 }
 
 class HashedCharArray
@@ -97,16 +101,17 @@ class HashedCharArray
   // template ctor from string literals allows hashing for code like
   // Proc::setParam("foo") to be done at compile time.
   template <size_t N>
-  constexpr HashedCharArray(const char (&sym)[N]) : len(N), hash(krHash1<N>(sym)), pChars(sym)
+  constexpr HashedCharArray(const char (&sym)[N])
+      : len(charArrayLength(sym)), hash(fnv1aHash(sym, charArrayLength(sym))), pChars(sym)
   {
   }
 
   // this non-constexpr ctor counts the string length at runtime.
-  HashedCharArray(const char* pC) : len(strlen(pC)), hash(krHash0(pC, len)), pChars(pC) {}
+  HashedCharArray(const char* pC) : len(strlen(pC)), hash(fnv1aHash(pC, len)), pChars(pC) {}
 
   // this non-constexpr ctor takes a string length parameter at runtime.
   HashedCharArray(const char* pC, size_t lengthBytes)
-      : len(lengthBytes), hash(krHash0(pC, len)), pChars(pC)
+      : len(lengthBytes), hash(fnv1aHash(pC, len)), pChars(pC)
   {
   }
 
@@ -114,12 +119,17 @@ class HashedCharArray
   HashedCharArray() : len(0), hash(0), pChars(nullptr) {}
 
   const size_t len;
-  const uint32_t hash;
+  const uint64_t hash;
   const char* pChars;
 };
 
 using SymbolID = size_t;
 
+// SymbolTable: looking up existing symbols and their texts takes no locks, so
+// the audio thread can do it while other threads are adding new symbols.
+// Adding a symbol is serialized by a single mutex. The storage is an
+// InternTable of symbol texts.
+
 class SymbolTable
 {
   friend class Symbol;
@@ -127,44 +137,79 @@ class SymbolTable
  public:
   SymbolTable();
   ~SymbolTable();
+
+  // clear all symbols. Not thread-safe: no other threads can be using symbols.
   void clear();
-  size_t getSize() { return mSymbolTextsByID.size(); }
+  size_t getSize() { return mEntries.size(); }
   void dump(void);
   int audit(void);
 
  protected:
   // look up a symbol by name and return its ID. Used in Symbol constructors.
   // if the symbol already exists, this routine must not allocate any heap
-  // memory.
+  // memory or take any locks.
   SymbolID getSymbolID(const HashedCharArray& hsl);
   SymbolID getSymbolID(const char* sym);
   SymbolID getSymbolID(const char* sym, size_t lengthBytes);
 
+  // look up a symbol from a constant char array such as a string literal. The
+  // address of the array is cached with its ID, so that after the first use the
+  // ID is found without hashing the text or searching the table.
+  template <size_t N>
+  inline SymbolID getSymbolIDFromLiteral(const char (&sym)[N])
+  {
+    LiteralCacheEntry& c = mLiteralCache[literalCacheIndex(sym)];
+    if (c.pChars.load(std::memory_order_acquire) == sym)
+    {
+      SymbolID id = c.id.load(std::memory_order_acquire);
+      if (c.pChars.load(std::memory_order_acquire) == sym)
+      {
+        // a constant array on the stack can have the address of a different one
+        // used earlier, so the text of the cached symbol is checked too.
+        const TextFragment& text = getEntry(id).text;
+        size_t len = text.lengthInBytes();
+        if ((len <= N) && !std::memcmp(text.getText(), sym, len) && ((len == N) || !sym[len]))
+        {
+          return id;
+        }
+      }
+    }
+    return cacheLiteral(HashedCharArray(sym));
+  }
+
   const TextFragment& getSymbolTextByID(SymbolID symID);
-  SymbolID addEntry(const HashedCharArray& hsl);
+  uint64_t getSymbolHashByID(SymbolID symID) { return getEntry(symID).hash; }
 
  private:
-  // vector of text fragments in ID/creation order
-  std::vector<TextFragment> mSymbolTextsByID;
-
-  // hash table containing indexes to strings for a given hash value.
-  struct TableEntry
+  // each symbol's text and the hash of its text.
+  struct Entry
   {
-    std::mutex mMutex;
-    std::vector<SymbolID> mIDVector;
+    TextFragment text;
+    uint64_t hash{0};
   };
 
-  void clearEntry(TableEntry& entry)
+  inline Entry& getEntry(SymbolID symID) { return mEntries.getEntry(symID); }
+
+  SymbolID cacheLiteral(const HashedCharArray& hsl);
+
+  static inline size_t literalCacheIndex(const char* pChars)
   {
-    std::unique_lock<std::mutex> lock(entry.mMutex);
-    entry.mIDVector.clear();
+    uint64_t mixed = reinterpret_cast<uintptr_t>(pChars) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(mixed >> (64 - kLiteralCacheBits));
   }
 
-  // since the maximum hash value is known, there will be no need to resize this
-  // array.
-  std::array<TableEntry, kHashTableSize> mHashTable;
+  InternTable<Entry, SymbolID, kSymbolChunkBits, kMaxSymbolChunks> mEntries;
 
-  size_t mSize{0};
+  // IDs of recently used literals, indexed by address. Entries are written only by
+  // the thread holding the add mutex: first pChars is cleared, then id is written,
+  // then pChars is set, so a reader that sees the same pChars before and after
+  // reading id knows the id is current.
+  struct LiteralCacheEntry
+  {
+    std::atomic<const char*> pChars{nullptr};
+    std::atomic<SymbolID> id{0};
+  };
+  std::array<LiteralCacheEntry, kLiteralCacheSize> mLiteralCache;
 };
 
 inline SymbolTable& theSymbolTable()
@@ -187,7 +232,23 @@ class Symbol
  public:
   Symbol() : id(0) {}
   Symbol(const HashedCharArray& hsl) : id(theSymbolTable().getSymbolID(hsl)) {}
-  Symbol(const char* pC) : id(theSymbolTable().getSymbolID(pC)) {}
+
+  // string literals and other constant char arrays are looked up by address
+  // after their first use, so making Symbols from literals in hot code is cheap.
+  template <size_t N>
+  Symbol(const char (&sym)[N]) : id(theSymbolTable().getSymbolIDFromLiteral(sym))
+  {
+  }
+
+  // pointers and non-constant char arrays, whose text may change, are looked up by text.
+  template <typename T, typename R = typename std::remove_reference<T>::type,
+            typename = typename std::enable_if<
+                std::is_convertible<T, const char*>::value &&
+                !(std::is_array<R>::value && std::is_const<typename std::remove_extent<R>::type>::value)>::type>
+  Symbol(T&& pC) : id(theSymbolTable().getSymbolID(static_cast<const char*>(pC)))
+  {
+  }
+
   Symbol(const char* pC, size_t lengthBytes) : id(theSymbolTable().getSymbolID(pC, lengthBytes)) {}
   Symbol(TextFragment frag) : id(theSymbolTable().getSymbolID(frag.getText(), frag.lengthInBytes()))
   {
@@ -201,32 +262,10 @@ class Symbol
 
   explicit operator bool() const { return id != 0; }
 
-  friend uint32_t hash(Symbol s);
+  friend uint64_t hash(Symbol s);
 
-  // search hash table for our id to find our hash.
-  // for testing only!
-  inline int getHashFromTable() const
-  {
-    int hash = 0;
-
-    for (auto& entry : theSymbolTable().mHashTable)
-    {
-      auto idVec = entry.mIDVector;
-      size_t idVecLen = idVec.size();
-      if (idVecLen > 0)
-      {
-        for (auto vid : idVec)
-        {
-          if (vid == id)
-          {
-            return hash;
-          }
-        }
-      }
-      hash++;
-    }
-    return 0;
-  }
+  // get the hash of our text, stored in the table.
+  inline uint64_t getHash() const { return theSymbolTable().getSymbolHashByID(id); }
 
   // return the symbol's TextFragment in the table.
   // in order to show the strings in XCode's debugger, instead of the unhelpful
@@ -252,7 +291,7 @@ class Symbol
   inline std::string toString() const { return std::string(getUTF8Ptr()); }
 };
 
-inline uint32_t hash(Symbol f) { return krHash0(f.getUTF8Ptr()); }
+inline uint64_t hash(Symbol f) { return f.getHash(); }
 
 inline Symbol operator+(Symbol f1, Symbol f2)
 {
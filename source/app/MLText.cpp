@@ -4,66 +4,17 @@
 
 #include "MLText.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <vector>
 
+#include "MLMemoryPool.h"
 #include "MLMemoryUtils.h"
 #include "utf.hpp"
 
 namespace ml
 {
-// Iterator::Impl
-
-class TextFragment::Iterator::Impl
-{
-  friend class TextFragment::Iterator;
-  friend bool operator!=(Iterator lhs, Iterator rhs);
-  friend bool operator==(Iterator lhs, Iterator rhs);
-
-  utf::codepoint_iterator<const char*> _utf8Iter;
-
- public:
-  Impl(const char* pos) : _utf8Iter(utf::codepoint_iterator<const char*>(pos)) {}
-  Impl(const utf::codepoint_iterator<const char*>& utf_iter) : _utf8Iter(utf_iter) {}
-};
-
-// Iterator
-
-TextFragment::Iterator::Iterator(const char* pos) { pImpl = std::unique_ptr<Impl>(new Impl(pos)); }
-
-TextFragment::Iterator::Iterator(const Iterator& it)  // = default;
-{
-  pImpl = std::unique_ptr<Impl>(new Impl(it.pImpl->_utf8Iter));
-}
-
-TextFragment::Iterator::~Iterator() = default;
-
-CodePoint TextFragment::Iterator::operator*() { return pImpl->_utf8Iter.operator*(); }
-
-TextFragment::Iterator& TextFragment::Iterator::operator++()
-{
-  pImpl->_utf8Iter.operator++();
-  return *this;
-}
-
-CodePoint TextFragment::Iterator::operator++(int i)
-{
-  CodePoint preIncrementValue = pImpl->_utf8Iter.operator*();
-  pImpl->_utf8Iter.operator++(i);
-  return preIncrementValue;
-}
-
-bool operator!=(TextFragment::Iterator lhs, TextFragment::Iterator rhs)
-{
-  return lhs.pImpl->_utf8Iter != rhs.pImpl->_utf8Iter;
-}
-
-bool operator==(TextFragment::Iterator lhs, TextFragment::Iterator rhs)
-{
-  return !(lhs.pImpl->_utf8Iter != rhs.pImpl->_utf8Iter);
-}
-
 // TextFragment
 
 TextFragment::TextFragment() noexcept
@@ -120,15 +71,7 @@ TextFragment::TextFragment(CodePoint c) noexcept
 
 size_t TextFragment::lengthInBytes() const { return _size; }
 
-size_t TextFragment::lengthInCodePoints() const
-{
-  utf::stringview<const char*> sv(_pText, _pText + _size);
-  return sv.codepoints();
-}
-
-TextFragment::Iterator TextFragment::begin() const { return TextFragment::Iterator(getText()); }
-
-TextFragment::Iterator TextFragment::end() const { return Iterator(getText() + lengthInBytes()); }
+size_t TextFragment::lengthInCodePoints() const { return countUTF8CodePoints(_pText, _size); }
 
 TextFragment::TextFragment(const TextFragment& a) noexcept
 {
@@ -263,7 +206,7 @@ void TextFragment::_allocate(size_t size) noexcept
   const size_t nullTerminatedSize = size + 1;
   if (nullTerminatedSize > kShortFragmentSizeInChars)
   {
-    _pText = static_cast<char*>(malloc(nullTerminatedSize));
+    _pText = static_cast<char*>(theMemoryPool().allocate(nullTerminatedSize));
   }
   else
   {
@@ -282,7 +225,7 @@ void TextFragment::_dispose() noexcept
     {
       // free an external text. If the alloc has failed the ptr might be 0,
       // which is OK
-      free(_pText);
+      theMemoryPool().deallocate(_pText);
     }
     _pText = 0;
   }
@@ -314,8 +257,184 @@ void TextFragment::_moveDataFromOther(TextFragment& b)
   b._nullTerminate();
 }
 
+// TextBuilder
+
+TextBuilder::TextBuilder(char* pBuffer, size_t capacity) noexcept
+{
+  if (pBuffer)
+  {
+    _pData = pBuffer;
+    _capacity = capacity;
+  }
+}
+
+TextBuilder::~TextBuilder() noexcept
+{
+  if (_ownsData)
+  {
+    theMemoryPool().deallocate(_pData);
+  }
+}
+
+bool TextBuilder::_grow(size_t minCapacity) noexcept
+{
+  // allocate one byte more than the capacity, so that takeText() can add the
+  // null terminator a TextFragment needs.
+  size_t newBytes = std::max(_capacity * 2, minCapacity + 1);
+  char* pNewData = static_cast<char*>(theMemoryPool().allocate(newBytes));
+  if (!pNewData) return false;
+  std::copy(_pData, _pData + _size, pNewData);
+  if (_ownsData)
+  {
+    theMemoryPool().deallocate(_pData);
+  }
+  _pData = pNewData;
+  _capacity = newBytes - 1;
+  _ownsData = true;
+  return true;
+}
+
+void TextBuilder::reserve(size_t lengthInBytes) noexcept
+{
+  if (lengthInBytes > _capacity)
+  {
+    _grow(lengthInBytes);
+  }
+}
+
+TextBuilder& TextBuilder::append(const char* pChars, size_t len) noexcept
+{
+  if (!_ok) return *this;
+  if ((_size + len > _capacity) && !_grow(_size + len))
+  {
+    _ok = false;
+    return *this;
+  }
+  if (len)
+  {
+    std::copy(pChars, pChars + len, _pData + _size);
+    _size += len;
+  }
+  return *this;
+}
+
+TextFragment TextBuilder::takeText() && noexcept
+{
+  TextFragment t;
+  if (_ok)
+  {
+    // a TextFragment keeps short text locally, so only long text can be handed over.
+    if (_ownsData && (_size >= kShortFragmentSizeInChars))
+    {
+      _pData[_size] = 0;
+      t._pText = _pData;
+      t._size = _size;
+      _pData = _localData;
+      _capacity = kShortFragmentSizeInChars;
+      _ownsData = false;
+    }
+    else
+    {
+      t = TextFragment(_pData, _size);
+    }
+  }
+  clear();
+  return t;
+}
+
+TextBuilder& TextBuilder::append(const char* pChars) noexcept
+{
+  return pChars ? append(pChars, strlen(pChars)) : *this;
+}
+
+TextBuilder& TextBuilder::append(CodePoint c) noexcept
+{
+  if (!validateCodePoint(c))
+  {
+    c = 0x2639;  // sad face, as in TextFragment(CodePoint)
+  }
+  char buf[4];
+  char* end = utf::internal::utf_traits<utf::utf8>::encode(c, buf);
+  return append(buf, end - buf);
+}
+
 bool validateCodePoint(CodePoint c) { return utf::internal::validate_codepoint(c); }
 
+// The functions below scan text eight bytes at a time where they can.
+
+namespace
+{
+constexpr uint64_t kHighBits{0x8080808080808080ull};
+constexpr uint64_t kLowBits{0x0101010101010101ull};
+
+inline uint64_t loadWord(const char* p)
+{
+  uint64_t w;
+  memcpy(&w, p, sizeof(w));
+  return w;
+}
+}  // namespace
+
+size_t asciiPrefixLength(const char* pChars, size_t lengthInBytes)
+{
+  size_t i = 0;
+  for (; i + 8 <= lengthInBytes; i += 8)
+  {
+    if (loadWord(pChars + i) & kHighBits) break;
+  }
+  while ((i < lengthInBytes) && !(pChars[i] & 0x80))
+  {
+    i++;
+  }
+  return i;
+}
+
+size_t countUTF8CodePoints(const char* pChars, size_t lengthInBytes)
+{
+  // count the continuation bytes 10xxxxxx, which have the high bit set and
+  // the next bit clear, and subtract them from the total.
+  size_t continuations = 0;
+  size_t i = 0;
+  for (; i + 8 <= lengthInBytes; i += 8)
+  {
+    uint64_t w = loadWord(pChars + i);
+    uint64_t c = (w & ~(w << 1)) & kHighBits;
+    continuations += static_cast<size_t>(((c >> 7) * kLowBits) >> 56);
+  }
+  for (; i < lengthInBytes; ++i)
+  {
+    continuations += ((pChars[i] & 0xC0) == 0x80);
+  }
+  return lengthInBytes - continuations;
+}
+
+bool validateUTF8(const char* pChars, size_t lengthInBytes)
+{
+  static constexpr CodePoint kMinCodePoints[5]{0, 0, 0x80, 0x800, 0x10000};
+  size_t i = 0;
+  while (true)
+  {
+    i += asciiPrefixLength(pChars + i, lengthInBytes - i);
+    if (i >= lengthInBytes) break;
+
+    auto lead = static_cast<unsigned char>(pChars[i]);
+    if (((lead & 0xC0) == 0x80) || (lead >= 0xF8)) return false;
+    size_t len = utf8SequenceLength(pChars[i]);
+    if (i + len > lengthInBytes) return false;
+    for (size_t j = 1; j < len; ++j)
+    {
+      if ((pChars[i + j] & 0xC0) != 0x80) return false;
+    }
+
+    // reject overlong encodings, surrogates and values past the last code point.
+    CodePoint c = decodeUTF8(pChars + i);
+    if (c < kMinCodePoints[len]) return false;
+    if (!validateCodePoint(c)) return false;
+    i += len;
+  }
+  return true;
+}
+
 // return UTF-8 encoded vector of bytes without null terminator
 std::vector<uint8_t> textToByteVector(TextFragment frag)
 {
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <iterator>
 #include <memory>
 #include <vector>
 
@@ -16,32 +18,74 @@ static constexpr int kShortFragmentSizeInChars = kShortFragmentSizeInCodePoints
 
 using CodePoint = char32_t;
 
+// number of bytes in the UTF-8 sequence starting with the given lead byte.
+// Invalid lead bytes are stepped over one byte at a time.
+inline size_t utf8SequenceLength(char lead)
+{
+  auto c = static_cast<unsigned char>(lead);
+  if (c < 0x80) return 1;
+  if ((c & 0xE0) == 0xC0) return 2;
+  if ((c & 0xF0) == 0xE0) return 3;
+  if ((c & 0xF8) == 0xF0) return 4;
+  return 1;
+}
+
+// decode the UTF-8 sequence starting at p.
+inline CodePoint decodeUTF8(const char* p)
+{
+  auto c = static_cast<unsigned char>(p[0]);
+  if (c < 0x80) return c;
+  size_t len = utf8SequenceLength(p[0]);
+  CodePoint r = (len == 2) ? (c & 0x1F) : (len == 3) ? (c & 0x0F) : (len == 4) ? (c & 0x07) : c;
+  for (size_t i = 1; i < len; ++i)
+  {
+    r = (r << 6) | (static_cast<unsigned char>(p[i]) & 0x3F);
+  }
+  return r;
+}
+
 // TextFragment: a string class designed to avoid using the heap. Guaranteed not to allocate
 // heap if the length in bytes is below kShortFragmentSize.
 
 class TextFragment
 {
  public:
+  // Iterator: visits the code points of UTF-8 text. It is just a pointer into
+  // the text, so it never allocates and is cheap to copy.
   class Iterator
   {
-    class Impl;
-    std::unique_ptr<Impl> pImpl;
+    const char* _pos{nullptr};
 
    public:
-    Iterator(const char* pos);
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = CodePoint;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const CodePoint*;
+    using reference = CodePoint;
+
+    Iterator() = default;
+    Iterator(const char* pos) : _pos(pos) {}
 
-    ~Iterator();  // defined in the implementation file, where impl is a
-                  // complete type
+    CodePoint operator*() const { return decodeUTF8(_pos); }
+
+    Iterator& operator++()
+    {
+      _pos += utf8SequenceLength(*_pos);
+      return *this;
+    }
 
-    Iterator(const Iterator&);
-    Iterator& operator=(const Iterator&) = delete;
+    CodePoint operator++(int)
+    {
+      CodePoint preIncrementValue = decodeUTF8(_pos);
+      ++(*this);
+      return preIncrementValue;
+    }
 
-    CodePoint operator*();
-    Iterator& operator++();
-    CodePoint operator++(int i);
+    // the position of the current code point in the text.
+    const char* getPosition() const { return _pos; }
 
-    friend bool operator!=(Iterator lhs, Iterator rhs);
-    friend bool operator==(Iterator lhs, Iterator rhs);
+    friend bool operator!=(Iterator lhs, Iterator rhs) { return lhs._pos != rhs._pos; }
+    friend bool operator==(Iterator lhs, Iterator rhs) { return lhs._pos == rhs._pos; }
   };
 
   TextFragment() noexcept;
@@ -105,8 +149,8 @@ class TextFragment
 
   size_t lengthInCodePoints() const;
 
-  Iterator begin() const;
-  Iterator end() const;
+  Iterator begin() const { return Iterator(_pText); }
+  Iterator end() const { return Iterator(_pText + _size); }
 
   inline const char* getText() const { return _pText; }
 
@@ -154,6 +198,9 @@ class TextFragment
   void _dispose() noexcept;
   void _moveDataFromOther(TextFragment& b);
 
+  // TextBuilder::takeText() hands its buffer to a new TextFragment.
+  friend class TextBuilder;
+
   // TODO these things could share space, as in SmallStackBuffer
   char _localText[kShortFragmentSizeInChars];
   char* _pText{_localText};
@@ -193,6 +240,74 @@ inline bool operator==(const TextFragment a, const TextFragment b)
 
 inline bool operator!=(TextFragment a, TextFragment b) { return !(a == b); }
 
+// TextBuilder: makes a TextFragment out of many pieces, appending each piece
+// to one buffer instead of copying all the text so far for each piece as the
+// concatenating constructors do. The buffer is local until it fills, or can be
+// memory supplied by the caller, such as part of an arena. After that it
+// grows using theMemoryPool(). takeText() hands a grown buffer to the finished
+// TextFragment without copying, so reserving the whole length up front makes
+// the text with a single allocation. If the buffer can't grow, ok() returns
+// false and the finished text is empty rather than truncated.
+
+class TextBuilder
+{
+ public:
+  TextBuilder() noexcept = default;
+
+  // build text in the given memory, until more is needed.
+  TextBuilder(char* pBuffer, size_t capacity) noexcept;
+
+  ~TextBuilder() noexcept;
+
+  TextBuilder(const TextBuilder&) = delete;
+  TextBuilder& operator=(const TextBuilder&) = delete;
+
+  TextBuilder& append(const char* pChars, size_t len) noexcept;
+  TextBuilder& append(const char* pChars) noexcept;
+  TextBuilder& append(const TextFragment& t) noexcept
+  {
+    return append(t.getText(), t.lengthInBytes());
+  }
+  TextBuilder& append(CodePoint c) noexcept;
+
+  // make room for the given total length, so that appending up to that
+  // length will not allocate.
+  void reserve(size_t lengthInBytes) noexcept;
+
+  void clear() noexcept
+  {
+    _size = 0;
+    _ok = true;
+  }
+
+  size_t lengthInBytes() const { return _size; }
+
+  // false if an allocation failed and some text was dropped.
+  bool ok() const { return _ok; }
+
+  // return a copy of the text so far.
+  TextFragment getText() const { return _ok ? TextFragment(_pData, _size) : TextFragment(); }
+
+  // return the finished text, moving our buffer into it if we allocated one.
+  // The builder is left empty.
+  TextFragment takeText() && noexcept;
+
+ private:
+  // returns false if the allocation failed.
+  bool _grow(size_t minCapacity) noexcept;
+
+  char _localData[kShortFragmentSizeInChars];
+  char* _pData{_localData};
+  size_t _size{0};
+  size_t _capacity{kShortFragmentSizeInChars};
+
+  // true if _pData was allocated by us. An allocated buffer has room for a
+  // null terminator after _capacity bytes.
+  bool _ownsData{false};
+
+  bool _ok{true};
+};
+
 inline std::ostream& operator<<(std::ostream& out, const TextFragment& r)
 {
   const char* c = r.getText();
@@ -202,6 +317,15 @@ inline std::ostream& operator<<(std::ostream& out, const TextFragment& r)
 
 bool validateCodePoint(CodePoint c);
 
+// return true if the bytes are valid UTF-8.
+bool validateUTF8(const char* pChars, size_t lengthInBytes);
+
+// return the number of code points in valid UTF-8 text.
+size_t countUTF8CodePoints(const char* pChars, size_t lengthInBytes);
+
+// return the number of bytes at the start of the text that are ASCII.
+size_t asciiPrefixLength(const char* pChars, size_t lengthInBytes);
+
 std::vector<uint8_t> textToByteVector(TextFragment frag);
 TextFragment byteVectorToText(const std::vector<uint8_t>& v);
 
@@ -324,6 +324,16 @@ int findFirst(const TextFragment& frag, const CodePoint b)
 {
   int r = npos;
   if (!frag) return r;
+
+  // in ASCII text, code point indices are byte indices.
+  const char* pChars = frag.getText();
+  size_t len = frag.lengthInBytes();
+  if ((b < 0x80) && (asciiPrefixLength(pChars, len) == len))
+  {
+    auto pFound = static_cast<const char*>(memchr(pChars, static_cast<int>(b), len));
+    return pFound ? static_cast<int>(pFound - pChars) : r;
+  }
+
   int i = 0;
   for (const CodePoint c : frag)
   {
@@ -342,6 +352,18 @@ int findLast(const TextFragment& frag, const CodePoint b)
 {
   int r = npos;
   if (!frag) return r;
+
+  const char* pChars = frag.getText();
+  size_t len = frag.lengthInBytes();
+  if ((b < 0x80) && (asciiPrefixLength(pChars, len) == len))
+  {
+    for (size_t i = len; i > 0; --i)
+    {
+      if (pChars[i - 1] == static_cast<char>(b)) return static_cast<int>(i - 1);
+    }
+    return r;
+  }
+
   int i = 0;
   for (const CodePoint c : frag)
   {
@@ -394,35 +416,32 @@ int findLast(const TextFragment& frag, std::function<bool(CodePoint)> matchFn)
 
 TextFragment subText(const TextFragment& frag, size_t start, size_t end)
 {
-  // this impl does an unneccesary copy, to keep TextFragment very simple for
-  // now.
   if (!frag) return TextFragment();
   if (start >= end) return TextFragment();
 
-  // temp buffer big enough to hold whole input fragment if needed.
-  // we won't know the output fragment size in bytes until iterating the code
-  // points.
+  // in ASCII text, code point indices are byte indices.
+  const char* pChars = frag.getText();
   size_t len = frag.lengthInBytes();
-  SmallStackBuffer<char, kShortFragmentSizeInChars> temp(len);
-  char* buf = temp.data();
-  char* pb = buf;
+  if (asciiPrefixLength(pChars, len) == len)
+  {
+    if (start >= len) return TextFragment();
+    return TextFragment(pChars + start, std::min(end, len) - start);
+  }
 
-  auto first = TextFragment::Iterator(frag.getText());
-  auto it = first;
-  for (int i = 0; i < start; ++i)
+  // otherwise, find the byte positions of the code points, stopping at the end
+  // of the text.
+  auto it = frag.begin();
+  for (size_t i = 0; (i < start) && (it != frag.end()); ++i)
   {
     ++it;
   }
-
-  for (int i = 0; i < end - start; ++i)
+  const char* pStart = it.getPosition();
+  for (size_t i = start; (i < end) && (it != frag.end()); ++i)
   {
-    // write the codepoint as UTF-8 to the buffer
     if (!validateCodePoint(*it)) return TextFragment();
-    pb = utf::internal::utf_traits<utf::utf8>::encode(*it, pb);
     ++it;
   }
-
-  return TextFragment(buf, pb - buf);
+  return TextFragment(pStart, it.getPosition() - pStart);
 }
 
 TextFragment map(const TextFragment& frag, std::function<CodePoint(CodePoint)> f)
@@ -455,76 +474,77 @@ TextFragment reduce(const TextFragment& frag, std::function<bool(CodePoint)> mat
 
 TextFragment replace(const TextFragment& frag, CodePoint toFind, CodePoint toReplace)
 {
-  TextFragment r{};
+  TextBuilder b;
+  b.reserve(frag.lengthInBytes());
   for (const CodePoint c : frag)
   {
-    if (c == toFind)
-    {
-      r = TextFragment(r, toReplace);
-    }
-    else
-    {
-      r = TextFragment(r, c);
-    }
+    b.append((c == toFind) ? toReplace : c);
   }
-  return r;
+  return std::move(b).takeText();
 }
 
 std::vector<TextFragment> split(TextFragment frag, CodePoint delimiter)
 {
+  // make each piece from the byte positions of its first and last code points.
   std::vector<TextFragment> output;
-  int start = 0;
-  int end = 0;
-  int pieceLen = 0;
-  for (const CodePoint c : frag)
+  const char* pPieceStart = frag.getText();
+  for (auto it = frag.begin(); it != frag.end(); ++it)
   {
+    const CodePoint c = *it;
     if (!validateCodePoint(c)) return std::vector<TextFragment>();
-    pieceLen++;
-    end++;
     if (c == delimiter)
     {
-      if (pieceLen > 1)
+      const char* pPieceEnd = it.getPosition();
+      if (pPieceEnd > pPieceStart)
       {
-        output.push_back(subText(frag, start, end - 1));
+        output.push_back(TextFragment(pPieceStart, pPieceEnd - pPieceStart));
       }
-      start = end;
-      pieceLen = 0;
+      pPieceStart = pPieceEnd + utf8SequenceLength(*pPieceEnd);
     }
   }
-  if (pieceLen > 0)
+  const char* pEnd = frag.getText() + frag.lengthInBytes();
+  if (pEnd > pPieceStart)
   {
-    output.push_back(subText(frag, start, end));
+    output.push_back(TextFragment(pPieceStart, pEnd - pPieceStart));
   }
   return output;
 }
 
 TextFragment join(const std::vector<TextFragment>& vec)
 {
-  TextFragment sum;
-  size_t len = vec.size();
-  for (int i = 0; i < len; ++i)
+  size_t totalLength = 0;
+  for (const auto& frag : vec)
+  {
+    totalLength += frag.lengthInBytes();
+  }
+  TextBuilder b;
+  b.reserve(totalLength);
+  for (const auto& frag : vec)
   {
-    TextFragment frag = vec[i];
-    sum = TextFragment(sum, vec[i]);
+    b.append(frag);
   }
-  return sum;
+  return std::move(b).takeText();
 }
 
 TextFragment join(const std::vector<TextFragment>& vec, CodePoint delimiter)
 {
-  TextFragment delimFrag(delimiter);
-  TextFragment sum;
   size_t len = vec.size();
-  for (int i = 0; i < len; ++i)
+  size_t totalLength = len ? (len - 1) * TextFragment(delimiter).lengthInBytes() : 0;
+  for (const auto& frag : vec)
+  {
+    totalLength += frag.lengthInBytes();
+  }
+  TextBuilder b;
+  b.reserve(totalLength);
+  for (size_t i = 0; i < len; ++i)
   {
-    TextFragment frag = vec[i];
-    sum = TextFragment(sum, vec[i]);
-    if ((i >= 0) && (i < len - 1))
+    b.append(vec[i]);
+    if (i < len - 1)
     {
-      sum = TextFragment(sum, delimFrag);
+      b.append(delimiter);
     }
   }
-  return sum;
+  return std::move(b).takeText();
 }
 
 TextFragment stripExtension(const TextFragment& frag)
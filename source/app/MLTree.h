@@ -190,9 +190,20 @@ class Tree
     return pNode;
   }
 
+  // remove the node at the path, and all of its children. Erasing the empty
+  // path clears the tree.
   void erase(Path p)
   {
-    // TODO
+    if (!p)
+    {
+      clear();
+      return;
+    }
+    Tree<V, C>* pParent = getNode(butLast(p));
+    if (pParent)
+    {
+      pParent->mChildren.erase(last(p));
+    }
   }
 
   // NOTE this iterator does not work with STL algorithms in general, only for
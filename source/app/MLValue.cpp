@@ -4,204 +4,201 @@
 
 #include "MLValue.h"
 
+#include <cstring>
+#include <new>
+
+#include "MLMemoryPool.h"
 #include "MLTextUtils.h"
 
 namespace ml
 {
 const Matrix Value::nullMatrix{};
 
-Value::Value() : mType(kUndefinedValue), mFloatVal(0) {}
+Value::Value() { _data.floatVal = 0.f; }
 
-void Value::copyBlob(const void* inputData, size_t size)
+// free any out of line storage and make the Value undefined.
+void Value::release()
 {
-  // if we have external data, free it
-  if(pBlobData != _localBlobData)
+  if (hasExternalData())
   {
-    free(pBlobData);
-    pBlobData = _localBlobData;
+    theMemoryPool().deallocate(_data.pData);
   }
-
-  if (size <= kLocalDataBytes)
+  else if (mType == kMatrixValue)
   {
-    auto pCharData = (uint8_t*)inputData;
-    std::copy(pCharData, pCharData + size, _localBlobData);
-    _blobSizeInBytes = size;
+    _data.pMatrix->~Matrix();
+    theMemoryPool().deallocate(_data.pMatrix);
   }
-  else
+  mType = kUndefinedValue;
+  _sizeInBytes = 0;
+}
+
+void Value::setData(Type t, const void* pData, size_t size)
+{
+  // reuse external data of the same size, so that setting a Value to another
+  // of the same size does not allocate.
+  if (!(hasExternalData() && (_sizeInBytes == size)))
   {
-    pBlobData = (uint8_t*)malloc(size);
-    if(pBlobData)
+    release();
+    if (size > kLocalDataBytes)
     {
-      auto pCharData = (uint8_t*)(inputData);
-      std::copy(pCharData, pCharData + size, pBlobData);
-      _blobSizeInBytes = size;
-    }
-    else
-    {
-      // TODO throw?
-      _blobSizeInBytes = 0;
+      _data.pData = static_cast<uint8_t*>(theMemoryPool().allocate(size));
+      if (!_data.pData)
+      {
+        // TODO throw?
+        size = 0;
+      }
     }
   }
+  mType = t;
+  _sizeInBytes = static_cast<uint32_t>(size);
+  if (size)
+  {
+    auto pCharData = static_cast<const uint8_t*>(pData);
+    std::copy(pCharData, pCharData + size, const_cast<uint8_t*>(getData()));
+  }
 }
 
-Value::Value(const Value& other) : mType(other.getType()), mFloatVal(0)
+void Value::setMatrix(const Matrix& m)
 {
-  switch (mType)
+  if (mType == kMatrixValue)
   {
-    case kUndefinedValue:
-      break;
-    case kFloatValue:
-      mFloatVal = other.getFloatValue();
-      break;
-    case kTextValue:
-      mTextVal = other.getTextValue();
-      break;
-    case kBlobValue:
-      copyBlob(other.pBlobData, other._blobSizeInBytes);
-      break;
-    case kMatrixValue:
-      mMatrixVal = other.getMatrixValue();
-      break;
-    case kUnsignedLongValue:
-      mUnsignedLongVal = other.getUnsignedLongValue();
-      break;
-    case kIntervalValue:
-      mIntervalVal = other.getIntervalValue();
-      break;
+    // Matrix handles copy-in-place when possible
+    *_data.pMatrix = m;
   }
+  else
+  {
+    release();
+    void* pMatrixData = theMemoryPool().allocate(sizeof(Matrix));
+    if (pMatrixData)
+    {
+      _data.pMatrix = new (pMatrixData) Matrix(m);
+      mType = kMatrixValue;
+    }
+  }
+}
+
+// take the storage of the other Value, leaving it undefined.
+void Value::moveFrom(Value& other)
+{
+  _data = other._data;
+  _sizeInBytes = other._sizeInBytes;
+  mType = other.mType;
+  other.mType = kUndefinedValue;
+  other._sizeInBytes = 0;
 }
 
+Value::Value(const Value& other) { setValue(other); }
+
 Value& Value::operator=(const Value& other)
 {
-  mType = other.getType();
-  switch (mType)
+  if (this != &other)
   {
-    case kUndefinedValue:
-      break;
-    case kFloatValue:
-      mFloatVal = other.getFloatValue();
-      break;
-    case kTextValue:
-      mTextVal = other.getTextValue();
-      break;
-    case kBlobValue:
-      copyBlob(other.pBlobData, other._blobSizeInBytes);
-      break;
-    case kMatrixValue:
-      // Matrix handles copy-in-place when possible
-      mMatrixVal = other.getMatrixValue();
-      break;
-    case kUnsignedLongValue:
-      mUnsignedLongVal = other.getUnsignedLongValue();
-      break;
-    case kIntervalValue:
-      mIntervalVal = other.getIntervalValue();
-      break;
+    setValue(other);
   }
+  return *this;
+}
+
+Value::Value(Value&& other) noexcept { moveFrom(other); }
 
+Value& Value::operator=(Value&& other) noexcept
+{
+  if (this != &other)
+  {
+    release();
+    moveFrom(other);
+  }
   return *this;
 }
 
-Value::Value(float v) : mType(kFloatValue) { mFloatVal = v; }
+Value::Value(float v) { setValue(v); }
 
-Value::Value(int v) : mType(kFloatValue) { mFloatVal = v; }
+Value::Value(int v) { setValue(v); }
 
-Value::Value(bool v) : mType(kFloatValue) { mFloatVal = v; }
+Value::Value(bool v) { setValue(v); }
 
-Value::Value(unsigned long v) : mType(kUnsignedLongValue) { mUnsignedLongVal = v; }
+Value::Value(unsigned long v) { setValue(static_cast<uint32_t>(v)); }
 
 // truncate to unsigned long for now. 
-Value::Value(unsigned long long v) : mType(kUnsignedLongValue) { mUnsignedLongVal = static_cast<unsigned long>(v); }
+Value::Value(unsigned long long v) { setValue(static_cast<uint32_t>(v)); }
 
-Value::Value(uint32_t v) : mType(kUnsignedLongValue) { mUnsignedLongVal = v; }
+Value::Value(uint32_t v) { setValue(v); }
 
-Value::Value(long v) : mType(kFloatValue) { mFloatVal = v; }
+Value::Value(long v) { setValue(v); }
 
-Value::Value(double v) : mType(kFloatValue) { mFloatVal = v; }
+Value::Value(double v) { setValue(v); }
 
-Value::Value(const ml::Text& t) : mType(kTextValue) { mTextVal = t; }
+Value::Value(const ml::Text& t) { setValue(t); }
 
-Value::Value(const char* t) : mType(kTextValue) { mTextVal = ml::Text(t); }
+Value::Value(const char* t) { setValue(t); }
 
-Value::Value(const ml::Matrix& s) : mType(kMatrixValue) { mMatrixVal = s; }
+Value::Value(const ml::Matrix& s) { setValue(s); }
 
-Value::Value(Interval i) : mType(kIntervalValue) { mIntervalVal = i; }
+Value::Value(Interval i) { setValue(i); }
 
-Value::Value(const void* pData, size_t n) : mType(kBlobValue)
-{
-  copyBlob(pData, n);
-}
+Value::Value(const void* pData, size_t n) { setData(kBlobValue, pData, n); }
 
-Value::~Value()
-{
-  // if we have external data, free it
-  if(pBlobData != _localBlobData)
-  {
-    free(pBlobData);
-  }
-}
+Value::~Value() { release(); }
 
 void Value::setValue(const float& v)
 {
+  release();
   mType = kFloatValue;
-  mFloatVal = v;
+  _data.floatVal = v;
 }
 
-void Value::setValue(const int& v)
-{
-  mType = kFloatValue;
-  mFloatVal = v;
-}
+void Value::setValue(const int& v) { setValue(static_cast<float>(v)); }
 
-void Value::setValue(const bool& v)
-{
-  mType = kFloatValue;
-  mFloatVal = v;
-}
+void Value::setValue(const bool& v) { setValue(static_cast<float>(v)); }
 
 void Value::setValue(const uint32_t& v)
 {
+  release();
   mType = kUnsignedLongValue;
-  mUnsignedLongVal = v;
+  _data.unsignedLongVal = v;
 }
 
-void Value::setValue(const long& v)
-{
-  mType = kFloatValue;
-  mFloatVal = v;
-}
+void Value::setValue(const long& v) { setValue(static_cast<float>(v)); }
 
-void Value::setValue(const double& v)
-{
-  mType = kFloatValue;
-  mFloatVal = v;
-}
+void Value::setValue(const double& v) { setValue(static_cast<float>(v)); }
 
-void Value::setValue(const ml::Text& v)
-{
-  mType = kTextValue;
-  mTextVal = v;
-}
+void Value::setValue(const ml::Text& v) { setData(kTextValue, v.getText(), v.lengthInBytes()); }
 
-void Value::setValue(const char* const v)
-{
-  mType = kTextValue;
-  mTextVal = v;
-}
+void Value::setValue(const char* const v) { setData(kTextValue, v, v ? strlen(v) : 0); }
 
-void Value::setValue(const Matrix& v)
-{
-  mType = kMatrixValue;
-  mMatrixVal = v;
-}
+void Value::setValue(const Matrix& v) { setMatrix(v); }
 
 void Value::setValue(const Interval v)
 {
+  release();
   mType = kIntervalValue;
-  mIntervalVal = v;
+  _data.intervalVal = v;
 }
 
-void Value::setValue(const Value& v) { *this = v; }
+void Value::setValue(const Value& v)
+{
+  switch (v.mType)
+  {
+    case kUndefinedValue:
+      release();
+      break;
+    case kFloatValue:
+      setValue(v._data.floatVal);
+      break;
+    case kTextValue:
+    case kBlobValue:
+      setData(v.mType, v.getData(), v._sizeInBytes);
+      break;
+    case kMatrixValue:
+      setMatrix(*v._data.pMatrix);
+      break;
+    case kUnsignedLongValue:
+      setValue(v._data.unsignedLongVal);
+      break;
+    case kIntervalValue:
+      setValue(v._data.intervalVal);
+      break;
+  }
+}
 
 bool Value::operator==(const Value& b) const
 {
@@ -217,7 +214,7 @@ bool Value::operator==(const Value& b) const
         r = (getFloatValue() == b.getFloatValue());
         break;
       case kTextValue:
-        r = (getTextValue() == b.getTextValue());
+        r = (_sizeInBytes == b._sizeInBytes) && std::equal(getData(), getData() + _sizeInBytes, b.getData());
         break;
       case kMatrixValue:
         r = (getMatrixValue() == b.getMatrixValue());
@@ -28,7 +28,9 @@ class Value
 {
  public:
 
-  static constexpr size_t kLocalDataBytes{256};
+  // text and blob data up to this size is stored in the Value itself.
+  // Larger data and Matrix values are stored out of line.
+  static constexpr size_t kLocalDataBytes{24};
   
   enum Type
   {
@@ -46,6 +48,8 @@ class Value
   Value();
   Value(const Value& other);
   Value& operator=(const Value& other);
+  Value(Value&& other) noexcept;
+  Value& operator=(Value&& other) noexcept;
   Value(float v);
   Value(int v);
   Value(bool v);
@@ -60,7 +64,7 @@ class Value
   Value(Interval i);
 
   // binary blob constructor.
-  // if data size > kBlobSizeBytes, this will allocate heap.
+  // if data size > kLocalDataBytes, this will allocate heap.
   explicit Value(const void* pData, size_t n);
 
   // matrix type constructor via initializer_list
@@ -83,69 +87,72 @@ class Value
 
   ~Value();
 
-  inline const float getFloatValue() const { return mFloatVal; }
+  inline const float getFloatValue() const { return (mType == kFloatValue) ? _data.floatVal : 0.f; }
 
   inline const float getFloatValueWithDefault(float d) const
   {
-    return (mType == kFloatValue) ? mFloatVal : d;
+    return (mType == kFloatValue) ? _data.floatVal : d;
   }
 
-  inline const float getBoolValue() const { return static_cast<bool>(mFloatVal); }
+  inline const float getBoolValue() const { return static_cast<bool>(getFloatValue()); }
 
   inline const bool getBoolValueWithDefault(bool b) const
   {
-    return (mType == kFloatValue) ? static_cast<bool>(mFloatVal) : b;
+    return (mType == kFloatValue) ? static_cast<bool>(_data.floatVal) : b;
   }
 
-  inline const int getIntValue() const { return static_cast<int>(mFloatVal); }
+  inline const int getIntValue() const { return static_cast<int>(getFloatValue()); }
 
   inline const int getIntValueWithDefault(int d) const
   {
-    return (mType == kFloatValue) ? static_cast<int>(mFloatVal) : d;
+    return (mType == kFloatValue) ? static_cast<int>(_data.floatVal) : d;
   }
 
-  inline const uint32_t getUnsignedLongValue() const { return mUnsignedLongVal; }
+  inline const uint32_t getUnsignedLongValue() const
+  {
+    return (mType == kUnsignedLongValue) ? _data.unsignedLongVal : 0;
+  }
 
   inline const uint32_t getUnsignedLongValueWithDefault(uint32_t d) const
   {
-    return (mType == kUnsignedLongValue) ? mUnsignedLongVal : d;
+    return (mType == kUnsignedLongValue) ? _data.unsignedLongVal : d;
   }
 
   inline const ml::Text getTextValue() const
   {
-    return (mType == kTextValue) ? (mTextVal) : ml::Text();
+    return (mType == kTextValue) ? ml::Text(getTextChars(), _sizeInBytes) : ml::Text();
   }
 
   inline const ml::Text getTextValueWithDefault(Text d) const
   {
-    return (mType == kTextValue) ? (mTextVal) : d;
+    return (mType == kTextValue) ? ml::Text(getTextChars(), _sizeInBytes) : d;
   }
 
   inline const Matrix& getMatrixValue() const
   {
-    return (mType == kMatrixValue) ? (mMatrixVal) : nullMatrix;
+    return (mType == kMatrixValue) ? (*_data.pMatrix) : nullMatrix;
   }
 
   inline const Matrix getMatrixValueWithDefault(Matrix d) const
   {
-    return (mType == kMatrixValue) ? (mMatrixVal) : d;
+    return (mType == kMatrixValue) ? (*_data.pMatrix) : d;
   }
 
   inline const Interval getIntervalValue() const
   {
-    return (mType == kIntervalValue) ? (mIntervalVal) : Interval();
+    return (mType == kIntervalValue) ? (_data.intervalVal) : Interval();
   }
   
   inline const Interval getIntervalValueWithDefault(Interval d) const
   {
-    return (mType == kIntervalValue) ? (mIntervalVal) : d;
+    return (mType == kIntervalValue) ? (_data.intervalVal) : d;
   }
   
   inline void* getBlobValue() const
   {
     if (mType == kBlobValue)
     {
-      return (void*)(pBlobData);
+      return (void*)(getData());
     }
     else
     {
@@ -157,7 +164,7 @@ class Value
   {
     if (mType == kBlobValue)
     {
-      return _blobSizeInBytes;
+      return _sizeInBytes;
     }
     else
     {
@@ -202,21 +209,33 @@ class Value
   bool operator<<(const Value& b) const;
 
  private:
-  void copyBlob(const void* inputData, size_t size);
+  // storage for each type. Only the member for the current type is valid.
+  union Storage
+  {
+    float floatVal;
+    uint32_t unsignedLongVal;
+    Interval intervalVal;
+    Matrix* pMatrix;
+    uint8_t* pData;
+    uint8_t localData[kLocalDataBytes];
+  };
+
+  // text and blob data is local if it fits.
+  inline bool hasExternalData() const
+  {
+    return ((mType == kTextValue) || (mType == kBlobValue)) && (_sizeInBytes > kLocalDataBytes);
+  }
+  inline const uint8_t* getData() const { return hasExternalData() ? _data.pData : _data.localData; }
+  inline const char* getTextChars() const { return reinterpret_cast<const char*>(getData()); }
 
-  uint8_t _localBlobData[kLocalDataBytes];
-  size_t _blobSizeInBytes;
-  uint8_t *pBlobData{_localBlobData};
+  void setData(Type t, const void* pData, size_t size);
+  void setMatrix(const Matrix& m);
+  void release();
+  void moveFrom(Value& other);
 
-  // TODO reduce storage requirements and reduce copying!
-  // this is a minimal-code start.
-  // everything will share space.
+  Storage _data;
+  uint32_t _sizeInBytes{0};
   Type mType{kUndefinedValue};
-  float mFloatVal{};
-  ml::Text mTextVal{};
-  Matrix mMatrixVal{};
-  uint32_t mUnsignedLongVal{};
-  Interval mIntervalVal{};
 };
 
 // NamedValue for initializer lists
@@ -53,6 +53,7 @@
 
 #include "MLDSPMath.h"
 #include "MLDSPScalarMath.h"
+#include "MLMemoryPool.h"
 #include "MLText.h"
 
 namespace ml
@@ -585,7 +586,8 @@ class Matrix final
       return mLocalData;
     }
 
-    float* newData = new float[size + kSignalAlignSize - 1];
+    float* newData = static_cast<float*>(
+        theMemoryPool().allocate((size + kSignalAlignSize - 1) * sizeof(float)));
     if (!newData) mSize = 0;
     return newData;
   }
@@ -594,7 +596,7 @@ class Matrix final
   {
     if (!(mData == mLocalData))
     {
-      delete[] mData;
+      theMemoryPool().deallocate(mData);
       mData = nullptr;
       mDataAligned = nullptr;
     }